@@ -0,0 +1,408 @@
+// buffercache.cc
+//  Routines to keep recently used disk sectors in memory.
+
+#include "system.h"
+#include "buffercache.h"
+
+BufferCache::BufferCache(SynchDisk* cachedDisk, int size) {
+    disk = cachedDisk;
+    numBuffers = size;
+    buffers = new Buffer[numBuffers];
+    hashBuckets = new int[numBuffers];
+    lock = new Lock("buffer cache");
+    bufferUnpinned = new Condition("buffer unpinned", lock);
+
+    newest = oldest = -1;
+    for (int i = 0; i < numBuffers; i++) {
+        buffers[i].sector = -1;
+        buffers[i].valid = false;
+        buffers[i].dirty = false;
+        buffers[i].readAhead = false;
+        buffers[i].pinCount = 0;
+        buffers[i].lock = new Lock("buffer");
+        buffers[i].hashNext = -1;
+        hashBuckets[i] = -1;
+        LruInsertNewest(i);
+    }
+
+    numDirty = 0;
+    flushWakeup = new Semaphore("flusher", 0);
+    flusherAwake = flushTimerPending = false;
+    Thread* thread = new Thread("buffer cache flusher", false, true);
+    thread->Fork(Run, this);
+
+    readAheadQueue = new List<int>();
+    readAheadQueued = 0;
+    readAheadWakeup = new Semaphore("read-ahead", 0);
+    thread = new Thread("buffer cache reader", false, true);
+    thread->Fork(RunReader, this);
+}
+
+BufferCache::~BufferCache() {
+    Flush();
+    delete flushWakeup;
+    delete readAheadQueue;
+    delete readAheadWakeup;
+    for (int i = 0; i < numBuffers; i++) {
+        delete buffers[i].lock;
+    }
+    delete[] buffers;
+    delete[] hashBuckets;
+    delete bufferUnpinned;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Pin
+//  Return the contents of "sector", held by the calling thread until
+//  it calls Unpin.  If the sector is not in the cache, it takes the
+//  least recently used buffer, waiting for one if they are all held,
+//  and writing it back first if it is dirty.
+//
+//  "overwrite" saves reading the sector from disk when the caller is
+//  about to write all of it.
+//----------------------------------------------------------------------
+
+char* BufferCache::Pin(int sector, bool overwrite) {
+    lock->Acquire();
+    if (Lookup(sector) != -1)
+        stats->numCacheHits++;
+    else
+        stats->numCacheMisses++;
+    int buffer = Grab(sector);
+    if (buffers[buffer].readAhead) {
+        buffers[buffer].readAhead = false;
+        stats->numReadAheadHits++;
+    }
+    lock->Release();
+
+    // the buffer is ours once whoever was using it is done
+    buffers[buffer].lock->Acquire();
+    if (!buffers[buffer].valid && !overwrite) {
+        disk->ReadSector(sector, buffers[buffer].data);
+        buffers[buffer].valid = true;
+    }
+    return buffers[buffer].data;
+}
+
+int BufferCache::Grab(int sector) {
+    // someone else may bring the sector in while we wait
+    int buffer = Lookup(sector);
+    while (buffer == -1) {
+        int victim = Victim();
+        if (victim == -1) {
+            bufferUnpinned->Wait(lock);
+        } else if (buffers[victim].dirty) {
+            buffers[victim].pinCount++;
+            lock->Release();
+            WriteBack(&victim, 1);
+            lock->Acquire();
+            Release(victim);
+        } else {
+            DEBUG('f', "Caching sector %d in buffer %d, was sector %d\n",
+                sector, victim, buffers[victim].sector);
+            if (buffers[victim].sector != -1)
+                HashRemove(victim);
+            buffers[victim].sector = sector;
+            buffers[victim].valid = false;
+            buffers[victim].readAhead = false;
+            HashInsert(victim);
+            buffer = victim;
+            break;
+        }
+        buffer = Lookup(sector);
+    }
+    buffers[buffer].pinCount++;
+    LruRemove(buffer);
+    LruInsertNewest(buffer);
+    return buffer;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Unpin
+//  Let go of the buffer of "sector".  If it is "dirty", it is written
+//  back later by the flusher.
+//----------------------------------------------------------------------
+
+void BufferCache::Unpin(int sector, bool dirty) {
+    // the buffer must be valid before anyone else can pin it, or they
+    // would read the old sector over what was just written.  Taking the
+    // cache lock with the buffer lock held is safe: no one holding the
+    // cache lock waits for a buffer lock.
+    lock->Acquire();
+    int buffer = Lookup(sector);
+    ASSERT(buffer != -1 && buffers[buffer].lock->isHeldByCurrentThread());
+    ASSERT(buffers[buffer].valid || dirty);  // Pin promised to overwrite
+
+    if (dirty) {
+        buffers[buffer].valid = true;
+        if (!buffers[buffer].dirty) {
+            buffers[buffer].dirty = true;
+            numDirty++;
+        }
+    }
+    buffers[buffer].lock->Release();
+
+    if (dirty) {
+        if (numDirty >= FlushHighWater) {
+            WakeFlusher();
+        } else if (!flushTimerPending) {
+            flushTimerPending = true;
+            interrupt->Schedule(FlushTimerExpired, this, FlushDelay,
+                TimerInt);
+        }
+    }
+    Release(buffer);
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::Flush
+//  Write all the dirty buffers back to disk, in order of sector.  They
+//  are pinned meanwhile, so that they are not reused.
+//----------------------------------------------------------------------
+
+void BufferCache::Flush() {
+    int* batch = new int[numBuffers];
+    int count = 0;
+
+    lock->Acquire();
+    for (int i = 0; i < numBuffers; i++) {
+        if (!buffers[i].dirty)
+            continue;
+        // insertion sort by sector
+        int j = count++;
+        for (; j > 0 && buffers[batch[j - 1]].sector > buffers[i].sector;
+            j--) {
+            batch[j] = batch[j - 1];
+        }
+        batch[j] = i;
+        buffers[i].pinCount++;
+    }
+    lock->Release();
+
+    // consecutive sectors are written back together
+    DEBUG('f', "Flushing %d dirty buffers\n", count);
+    for (int i = 0, run; i < count; i += run) {
+        for (run = 1; i + run < count && run < MaxTransfer; run++) {
+            if (buffers[batch[i + run]].sector !=
+                buffers[batch[i]].sector + run)
+                break;
+        }
+        WriteBack(&batch[i], run);
+    }
+
+    lock->Acquire();
+    for (int i = 0; i < count; i++) {
+        Release(batch[i]);
+    }
+    lock->Release();
+    delete[] batch;
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadAhead
+//  Queue "sector" for the reader thread, which reads it into the cache
+//  while the caller goes on.
+//----------------------------------------------------------------------
+
+void BufferCache::ReadAhead(int sector) {
+    lock->Acquire();
+    if (Lookup(sector) == -1 && readAheadQueued < MaxReadAheadQueue) {
+        readAheadQueue->Append(sector);
+        readAheadQueued++;
+        readAheadWakeup->V();
+    }
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// BufferCache::ReadNextAhead
+//  Read the next sector in the queue into the cache, together with the
+//  ones queued after it that follow it on disk, in a single transfer.
+//----------------------------------------------------------------------
+
+void BufferCache::ReadNextAhead() {
+    int run[MaxTransfer];
+    char* data[MaxTransfer];
+    int count = 0;
+
+    readAheadWakeup->P();
+    lock->Acquire();
+    int sector = readAheadQueue->Remove();
+    readAheadQueued--;
+    for (;;) {
+        if (Lookup(sector + count) != -1)
+            break;  // someone read it meanwhile
+        run[count] = Grab(sector + count);
+        buffers[run[count]].readAhead = true;
+        stats->numReadAheads++;
+        if (++count == MaxTransfer || readAheadQueued == 0)
+            break;
+        int nextSector = readAheadQueue->Remove();
+        if (nextSector != sector + count) {
+            readAheadQueue->Prepend(nextSector);
+            break;
+        }
+        readAheadWakeup->P();  // does not wait, the sector was queued
+        readAheadQueued--;
+    }
+    lock->Release();
+    if (count == 0)
+        return;
+
+    // someone may have written a buffer before we got it; the transfer
+    // stops short of the first such
+    for (int i = 0; i < count; i++) {
+        buffers[run[i]].lock->Acquire();
+        data[i] = buffers[run[i]].data;
+    }
+    int toRead = 0;
+    while (toRead < count && !buffers[run[toRead]].valid)
+        toRead++;
+    if (toRead > 0) {
+        DEBUG('f', "Reading %d sectors ahead, from sector %d\n", toRead,
+            sector);
+        disk->ReadSectors(sector, toRead, data);
+    }
+    for (int i = 0; i < count; i++) {
+        if (i < toRead)
+            buffers[run[i]].valid = true;
+        buffers[run[i]].lock->Release();
+    }
+
+    lock->Acquire();
+    for (int i = 0; i < count; i++) {
+        Release(run[i]);
+    }
+    lock->Release();
+}
+
+void BufferCache::WriteBack(int* run, int count) {
+    char* data[MaxTransfer];
+
+    ASSERT(count <= MaxTransfer);
+    for (int i = 0; i < count; i++) {
+        buffers[run[i]].lock->Acquire();
+        data[i] = buffers[run[i]].data;
+    }
+    // a buffer cleaned meanwhile holds what the disk does, so writing it
+    // again does no harm, and keeps the run in one piece
+    int first = 0, last = count - 1;
+    while (first <= last && !buffers[run[first]].dirty)
+        first++;
+    while (last >= first && !buffers[run[last]].dirty)
+        last--;
+    if (first <= last) {
+        disk->WriteSectors(buffers[run[first]].sector, last - first + 1,
+            &data[first]);
+    }
+    for (int i = first; i <= last; i++) {
+        if (buffers[run[i]].dirty) {
+            buffers[run[i]].dirty = false;
+            numDirty--;
+            stats->numCacheWriteBacks++;
+        }
+    }
+    for (int i = 0; i < count; i++) {
+        buffers[run[i]].lock->Release();
+    }
+}
+
+void BufferCache::Release(int buffer) {
+    if (--buffers[buffer].pinCount == 0)
+        bufferUnpinned->Broadcast(lock);
+}
+
+void BufferCache::Run(void* arg) {
+    BufferCache* cache = static_cast<BufferCache*>(arg);
+    for (;;) {
+        cache->flushWakeup->P();
+        cache->flusherAwake = false;
+        cache->Flush();
+    }
+}
+
+void BufferCache::RunReader(void* arg) {
+    for (;;) {
+        static_cast<BufferCache*>(arg)->ReadNextAhead();
+    }
+}
+
+void BufferCache::FlushTimerExpired(void* arg) {
+    BufferCache* cache = static_cast<BufferCache*>(arg);
+    cache->flushTimerPending = false;
+    cache->WakeFlusher();
+}
+
+void BufferCache::WakeFlusher() {
+    if (!flusherAwake) {
+        flusherAwake = true;
+        flushWakeup->V();
+    }
+}
+
+void BufferCache::ReadSector(int sector, char* data) {
+    bcopy(Pin(sector), data, SectorSize);
+    Unpin(sector, false);
+}
+
+void BufferCache::WriteSector(int sector, const char* data) {
+    bcopy(data, Pin(sector, true), SectorSize);
+    Unpin(sector, true);
+}
+
+int BufferCache::Lookup(int sector) {
+    int buffer = hashBuckets[Hash(sector)];
+    while (buffer != -1 && buffers[buffer].sector != sector) {
+        buffer = buffers[buffer].hashNext;
+    }
+    return buffer;
+}
+
+int BufferCache::Victim() {
+    int buffer = oldest;
+    while (buffer != -1 && buffers[buffer].pinCount > 0) {
+        buffer = buffers[buffer].newer;
+    }
+    return buffer;
+}
+
+void BufferCache::HashInsert(int buffer) {
+    int bucket = Hash(buffers[buffer].sector);
+    buffers[buffer].hashNext = hashBuckets[bucket];
+    hashBuckets[bucket] = buffer;
+}
+
+void BufferCache::HashRemove(int buffer) {
+    int* link = &hashBuckets[Hash(buffers[buffer].sector)];
+    while (*link != buffer) {
+        ASSERT(*link != -1);
+        link = &buffers[*link].hashNext;
+    }
+    *link = buffers[buffer].hashNext;
+    buffers[buffer].hashNext = -1;
+}
+
+void BufferCache::LruRemove(int buffer) {
+    Buffer* b = &buffers[buffer];
+    if (b->newer != -1)
+        buffers[b->newer].older = b->older;
+    else
+        newest = b->older;
+    if (b->older != -1)
+        buffers[b->older].newer = b->newer;
+    else
+        oldest = b->newer;
+    b->newer = b->older = -1;
+}
+
+void BufferCache::LruInsertNewest(int buffer) {
+    buffers[buffer].older = newest;
+    buffers[buffer].newer = -1;
+    if (newest != -1)
+        buffers[newest].newer = buffer;
+    else
+        oldest = buffer;
+    newest = buffer;
+}
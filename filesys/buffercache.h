@@ -0,0 +1,125 @@
+// buffercache.h
+//  Data structures for the buffer cache: copies of recently used disk
+//  sectors, kept in memory so that the file system does not go to the
+//  disk every time it reads a sector.
+//
+//  Buffers are looked up by sector in a hash table.  A sector that is
+//  not in the cache takes the least recently used buffer that nobody
+//  holds.  A thread holds ("pins") a buffer while it reads or changes
+//  its contents; meanwhile other threads wait to use it, and it is not
+//  given to another sector.
+//
+//  Changes stay in the cache ("write-behind"): a flusher thread writes
+//  the dirty buffers back, in order of sector, FlushDelay ticks after
+//  a buffer first gets dirty, or right away once FlushHighWater of them
+//  are.  A dirty buffer that is about to be reused is written back
+//  first.  Flush writes everything back at once, each run of
+//  consecutive sectors in a single transfer.
+//
+//  Sectors about to be read can be asked for ahead of time; a reader
+//  thread brings them in, consecutive ones together, while the thread
+//  that asked goes on.
+
+#ifndef FILESYS_BUFFERCACHE_H_
+#define FILESYS_BUFFERCACHE_H_
+
+#include "disk.h"
+#include "synch.h"
+#include "synchdisk.h"
+
+#define NumCacheBuffers 64  // Sectors the cache holds
+#define FlushDelay 50000  // Ticks a change may wait to be written back
+#define FlushHighWater (numBuffers / 2)  // Dirty buffers that wake the
+                                         // flusher up right away
+#define MaxReadAheadQueue (numBuffers / 4)  // Sectors waiting to be read
+                                            // ahead, at most
+
+class BufferCache {
+ public:
+    // Cache the sectors of "disk" in "numBuffers" buffers, and start
+    // the flusher thread
+    BufferCache(SynchDisk* disk, int numBuffers);
+    ~BufferCache();  // Flush, and de-allocate the cache
+
+    // Hold the buffer of "sector" and return its contents; they are
+    // read from disk first, unless the caller is going to "overwrite"
+    // all of them
+    char* Pin(int sector, bool overwrite = false);
+
+    // Let go of the buffer of "sector"; "dirty" if its contents changed
+    void Unpin(int sector, bool dirty);
+
+    // Write every dirty buffer back to disk
+    void Flush();
+
+    // Bring "sector" into the cache in the background, if it is not
+    // there; nothing happens if too many sectors are waiting already
+    void ReadAhead(int sector);
+
+    // Copy a whole sector out of or into the cache
+    void ReadSector(int sector, char* data);
+    void WriteSector(int sector, const char* data);
+
+ private:
+    struct Buffer {
+        int sector;  // Sector it holds, or -1
+        bool valid;  // Read from disk, or written in full
+        bool dirty;  // Changed since read from or written to disk
+        bool readAhead;  // Read ahead, and not pinned since
+        int pinCount;  // Threads holding it or waiting for it
+        Lock* lock;  // Held by the thread using its contents
+        int hashNext;  // Next buffer in the same hash bucket, or -1
+        int newer, older;  // Neighbours in the LRU list, or -1
+        char data[SectorSize];
+    };
+
+    // Buffer holding "sector", or -1
+    int Lookup(int sector);
+
+    // Least recently used buffer nobody holds, or -1
+    int Victim();
+
+    // Add to the pin count of the buffer of "sector", giving it one
+    // first if it has none; the caller must hold the cache lock
+    int Grab(int sector);
+
+    // Write the "count" buffers of "run", which hold consecutive
+    // sectors, back to disk in one transfer if any is dirty; the caller
+    // must have added to their pin counts, but not hold the cache lock
+    void WriteBack(int* run, int count);
+
+    // Take one off the pin count of "buffer", with the cache lock held
+    void Release(int buffer);
+
+    static void Run(void* cache);  // Body of the flusher thread
+    static void RunReader(void* cache);  // Body of the read-ahead thread
+    void ReadNextAhead();
+    static void FlushTimerExpired(void* cache);  // Interrupt handler
+    void WakeFlusher();
+
+    int Hash(int sector) { return sector % numBuffers; }
+    void HashInsert(int buffer);
+    void HashRemove(int buffer);
+    void LruRemove(int buffer);
+    void LruInsertNewest(int buffer);
+
+    SynchDisk* disk;
+    int numBuffers;
+    Buffer* buffers;
+    int* hashBuckets;  // First buffer of each bucket, or -1
+    int newest, oldest;  // Ends of the LRU list
+    Lock* lock;  // Protects the sectors, pin counts, hash table and
+                 // LRU list, but not the contents of the buffers
+    Condition* bufferUnpinned;  // Some pin count dropped to 0
+
+    int numDirty;  // Dirty buffers
+    Semaphore* flushWakeup;  // The flusher waits here
+    bool flusherAwake;  // Woken up, and not done yet
+    bool flushTimerPending;  // The flusher is due to be woken up
+
+    List<int>* readAheadQueue;  // Sectors to read ahead
+    int readAheadQueued;  // How many
+    Semaphore* readAheadWakeup;  // Counts them, for the reader thread
+};
+
+#endif  // FILESYS_BUFFERCACHE_H_
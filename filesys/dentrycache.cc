@@ -0,0 +1,173 @@
+// dentrycache.cc
+//  Routines to keep recently looked up names in memory.
+
+#include "copyright.h"
+#include "utility.h"
+#include "directory.h"
+#include "dentrycache.h"
+
+DentryCache::DentryCache(int size) {
+    numEntries = size;
+    entries = new Dentry[numEntries];
+    hashBuckets = new int[numEntries];
+
+    newest = oldest = -1;
+    for (int i = 0; i < numEntries; i++) {
+        entries[i].dirSector = -1;
+        entries[i].name = NULL;
+        entries[i].hashNext = -1;
+        hashBuckets[i] = -1;
+        LruInsertNewest(i);
+    }
+}
+
+DentryCache::~DentryCache() {
+    for (int i = 0; i < numEntries; i++) {
+        delete[] entries[i].name;
+    }
+    delete[] entries;
+    delete[] hashBuckets;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Lookup
+//  Return the sector of the file header of "name" in the directory
+//  whose header is at "dirSector", and set "isDirectory", if the name
+//  is cached; return -1 otherwise.  A name found becomes the most
+//  recently used.
+//----------------------------------------------------------------------
+
+int DentryCache::Lookup(int dirSector, const char* name, bool* isDirectory) {
+    int entry = Find(dirSector, name);
+    if (entry == -1) {
+        return -1;
+    }
+    LruRemove(entry);
+    LruInsertNewest(entry);
+    *isDirectory = entries[entry].isDirectory;
+    return entries[entry].sector;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Enter
+//  Cache "name", in the entry it has already or else in the least
+//  recently used one, which is always at the old end of the LRU list:
+//  unused entries are moved there when cleared.
+//----------------------------------------------------------------------
+
+void DentryCache::Enter(int dirSector, const char* name, int sector,
+                        bool isDirectory) {
+    int entry = Find(dirSector, name);
+    if (entry == -1) {
+        entry = oldest;
+        Clear(entry);
+        entries[entry].dirSector = dirSector;
+        entries[entry].name = new char[strlen(name) + 1];
+        strcpy(entries[entry].name, name);
+        HashInsert(entry);
+    }
+    entries[entry].sector = sector;
+    entries[entry].isDirectory = isDirectory;
+    LruRemove(entry);
+    LruInsertNewest(entry);
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Forget
+//  Drop "name" in "dirSector" from the cache, if it is there, when the
+//  file system removes it.  The entry goes to the old end of the LRU
+//  list, to be the next one reused.
+//----------------------------------------------------------------------
+
+void DentryCache::Forget(int dirSector, const char* name) {
+    int entry = Find(dirSector, name);
+    if (entry != -1) {
+        Clear(entry);
+        LruRemove(entry);
+        LruInsertOldest(entry);
+    }
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Find
+//  Return the entry holding "name" in "dirSector", or -1, looking only
+//  through its hash bucket.  The LRU list is left alone.
+//----------------------------------------------------------------------
+
+int DentryCache::Find(int dirSector, const char* name) {
+    int entry = hashBuckets[Hash(dirSector, name)];
+    while (entry != -1 && (entries[entry].dirSector != dirSector ||
+                           strcmp(entries[entry].name, name) != 0)) {
+        entry = entries[entry].hashNext;
+    }
+    return entry;
+}
+
+//----------------------------------------------------------------------
+// DentryCache::Clear
+//  Leave "entry" unused, taking it out of its hash bucket.  The caller
+//  decides where it goes in the LRU list.
+//----------------------------------------------------------------------
+
+void DentryCache::Clear(int entry) {
+    if (entries[entry].dirSector != -1) {
+        HashRemove(entry);
+        entries[entry].dirSector = -1;
+        delete[] entries[entry].name;
+        entries[entry].name = NULL;
+    }
+}
+
+int DentryCache::Hash(int dirSector, const char* name) {
+    return (Directory::Hash(name) + dirSector * 31u) % numEntries;
+}
+
+void DentryCache::HashInsert(int entry) {
+    int bucket = Hash(entries[entry].dirSector, entries[entry].name);
+    entries[entry].hashNext = hashBuckets[bucket];
+    hashBuckets[bucket] = entry;
+}
+
+void DentryCache::HashRemove(int entry) {
+    int* link =
+        &hashBuckets[Hash(entries[entry].dirSector, entries[entry].name)];
+    while (*link != entry) {
+        ASSERT(*link != -1);
+        link = &entries[*link].hashNext;
+    }
+    *link = entries[entry].hashNext;
+    entries[entry].hashNext = -1;
+}
+
+void DentryCache::LruRemove(int entry) {
+    Dentry* d = &entries[entry];
+    if (d->newer != -1)
+        entries[d->newer].older = d->older;
+    else
+        newest = d->older;
+    if (d->older != -1)
+        entries[d->older].newer = d->newer;
+    else
+        oldest = d->newer;
+    d->newer = d->older = -1;
+}
+
+void DentryCache::LruInsertNewest(int entry) {
+    entries[entry].older = newest;
+    entries[entry].newer = -1;
+    if (newest != -1)
+        entries[newest].newer = entry;
+    else
+        oldest = entry;
+    newest = entry;
+}
+
+void DentryCache::LruInsertOldest(int entry) {
+    entries[entry].newer = oldest;
+    entries[entry].older = -1;
+    if (oldest != -1)
+        entries[oldest].older = entry;
+    else
+        newest = entry;
+    oldest = entry;
+}
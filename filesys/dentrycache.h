@@ -0,0 +1,67 @@
+// dentrycache.h
+//  Data structures for the dentry cache: the names the file system
+//  looked up recently, and what they were found to be, kept in memory
+//  so that resolving a path does not go to the directories on disk
+//  for each of its components.
+//
+//  An entry maps a name in a directory, both given, to the sector of
+//  the file header it names, and whether that is a directory too.
+//  Entries are looked up in a hash table; a name that is not cached
+//  takes the least recently used entry.  Only names that were found
+//  are cached; the file system forgets a name when it removes it.
+//
+//  We assume mutual exclusion is provided by the caller.
+
+#ifndef FILESYS_DENTRYCACHE_H_
+#define FILESYS_DENTRYCACHE_H_
+
+#define NumDentries 256  // Names the cache holds
+
+class DentryCache {
+ public:
+    // Cache up to "numEntries" names
+    explicit DentryCache(int numEntries);
+    ~DentryCache();
+
+    // Sector of the file header of "name" in the directory whose
+    // header is at "dirSector", and whether it is a directory, or -1
+    // if the name is not cached
+    int Lookup(int dirSector, const char* name, bool* isDirectory);
+
+    // Remember that "name" in "dirSector" is at "sector"
+    void Enter(int dirSector, const char* name, int sector,
+               bool isDirectory);
+
+    // Forget "name" in "dirSector", if it is cached
+    void Forget(int dirSector, const char* name);
+
+ private:
+    struct Dentry {
+        int dirSector;  // Directory the name is in, or -1 if unused
+        char* name;
+        int sector;  // Header of the file or directory it names
+        bool isDirectory;
+        int hashNext;  // Next entry in the same hash bucket, or -1
+        int newer, older;  // Neighbours in the LRU list, or -1
+    };
+
+    // Entry for "name" in "dirSector", or -1
+    int Find(int dirSector, const char* name);
+
+    // Drop "entry" from the cache, leaving it unused
+    void Clear(int entry);
+
+    int Hash(int dirSector, const char* name);
+    void HashInsert(int entry);
+    void HashRemove(int entry);
+    void LruRemove(int entry);
+    void LruInsertNewest(int entry);
+    void LruInsertOldest(int entry);
+
+    int numEntries;
+    Dentry* entries;
+    int* hashBuckets;  // First entry of each bucket, or -1
+    int newest, oldest;  // Ends of the LRU list
+};
+
+#endif  // FILESYS_DENTRYCACHE_H_
@@ -1,23 +1,24 @@
-// directory.cc 
+// directory.cc
 //	Routines to manage a directory of file names.
 //
-//	The directory is a table of fixed length entries; each
-//	entry represents a single file, and contains the file name,
-//	and the location of the file header on disk.  The fixed size
-//	of each directory entry means that we have the restriction
-//	of a fixed maximum size for file names.
+//	The directory is a hash table of entries; each entry
+//	represents a single file, and contains the file name,
+//	and the location of the file header on disk.  A name hashes
+//	to one of the buckets, and the entries in a bucket are linked
+//	together, so that looking a name up only reads the entries
+//	whose names hash to the same bucket.  Names can have any length
+//	up to FileNameMaxLen.
 //
-//	The constructor initializes an empty directory of a certain size;
-//	we use ReadFrom/WriteBack to fetch the contents of the directory
-//	from disk, and to write back any modifications back to disk.
-//
-//	Also, this implementation has the restriction that the size
-//	of the directory cannot expand.  In other words, once all the
-//	entries in the directory are used, no more files can be created.
-//	Fixing this is one of the parts to the assignment.
+//	The table is kept in a Nachos file, and read and written in
+//	place; the buffer cache holds on to the parts in use.  The file
+//	grows as entries are added.  When there get to be more than
+//	MaxLoad entries per bucket, the directory is rewritten with
+//	twice as many buckets, so that the chains stay short; and when
+//	half of it is removed entries, it is rewritten to take their
+//	space back.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
-// All rights reserved.  See copyright.h for copyright notice and limitation 
+// All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
@@ -27,171 +28,420 @@
 
 //----------------------------------------------------------------------
 // Directory::Directory
-// 	Initialize a directory; initially, the directory is completely
-//	empty.  If the disk is being formatted, an empty directory
-//	is all we need, but otherwise, we need to call FetchFrom in order
-//	to initialize it from disk.
+// 	Open a directory.  If the disk is being formatted, or the
+//	directory is new, Initialize makes it empty; otherwise its header
+//	is read from the file.
 //
-//	"size" is the number of entries in the directory
+//	"sector" is where the header of the directory file is on disk
 //----------------------------------------------------------------------
 
-Directory::Directory(int size)
+Directory::Directory(int sector)
 {
-    table = new DirectoryEntry[size];
-    tableSize = size;
-    for (int i = 0; i < tableSize; i++)
-	table[i].inUse = false;
+    file = new OpenFile(sector);
+    file->ReadAt((char *)&hdr, sizeof(DirectoryHeader), 0);
 }
 
 //----------------------------------------------------------------------
 // Directory::~Directory
-// 	De-allocate directory data structure.
+// 	Close the directory file.
 //----------------------------------------------------------------------
 
 Directory::~Directory()
-{ 
-    delete [] table;
-} 
+{
+    delete file;
+}
 
 //----------------------------------------------------------------------
-// Directory::FetchFrom
-// 	Read the contents of the directory from disk.
+// Directory::Initialize
+// 	Write an empty directory, with InitialBuckets empty buckets, to
+//	the directory file.
 //
-//	"file" -- file containing the directory contents
+//	"parentSector" -- the header of the directory this one is in
 //----------------------------------------------------------------------
 
 void
-Directory::FetchFrom(OpenFile *file)
+Directory::Initialize(int parentSector)
 {
-    file->ReadAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    int size = BucketOffset(InitialBuckets);
+    char *image = new char[size];
+
+    bzero(image, size);
+    hdr.numEntries = 0;
+    hdr.numBuckets = InitialBuckets;
+    hdr.end = size;
+    hdr.unused = 0;
+    hdr.parent = parentSector;
+    bcopy((char *)&hdr, image, sizeof(DirectoryHeader));
+    file->WriteAt(image, size, 0);
+    delete [] image;
 }
 
 //----------------------------------------------------------------------
-// Directory::WriteBack
-// 	Write any modifications to the directory back to disk
-//
-//	"file" -- file to contain the new directory contents
+// Directory::Hash
+// 	Hash a file name (FNV-1a), for the directory and the dentry cache.
 //----------------------------------------------------------------------
 
-void
-Directory::WriteBack(OpenFile *file)
+unsigned
+Directory::Hash(const char *name)
+{
+    unsigned hash = 2166136261u;
+
+    for (; *name != '\0'; name++)
+	hash = (hash ^ (unsigned char) *name) * 16777619u;
+    return hash;
+}
+
+//----------------------------------------------------------------------
+// Directory::ReadEntry
+// 	Read the entry at "offset" in the directory file, and its name,
+//	with a trailing '\0'.  Return "offset".
+//----------------------------------------------------------------------
+
+int
+Directory::ReadEntry(int offset, DirectoryEntry *entry, char *name)
+{
+    file->ReadAt((char *)entry, sizeof(DirectoryEntry), offset);
+    ASSERT(entry->nameLen > 0 && entry->nameLen <= FileNameMaxLen);
+    file->ReadAt(name, entry->nameLen, offset + sizeof(DirectoryEntry));
+    name[entry->nameLen] = '\0';
+    return offset;
+}
+
+//----------------------------------------------------------------------
+// Directory::NextEntry
+// 	Read the entry after the one at "offset", already read into
+//	"entry" and "name": the next one in its bucket, or the first one
+//	in the next bucket that is not empty.  Start with the first entry
+//	if "offset" is 0.  Return the offset of the entry read, or 0 if
+//	there are no more.
+//----------------------------------------------------------------------
+
+int
+Directory::NextEntry(int offset, DirectoryEntry *entry, char *name)
 {
-    file->WriteAt((char *)table, tableSize * sizeof(DirectoryEntry), 0);
+    int bucket = 0, head;
+
+    if (offset != 0) {
+	if (entry->next != 0)
+	    return ReadEntry(entry->next, entry, name);
+	bucket = Hash(name) % hdr.numBuckets + 1;
+    }
+    for (; bucket < hdr.numBuckets; bucket++) {
+	file->ReadAt((char *)&head, sizeof(int), BucketOffset(bucket));
+	if (head != 0)
+	    return ReadEntry(head, entry, name);
+    }
+    return 0;
 }
 
 //----------------------------------------------------------------------
-// Directory::FindIndex
-// 	Look up file name in directory, and return its location in the table of
-//	directory entries.  Return -1 if the name isn't in the directory.
+// Directory::FindEntry
+// 	Look up file name in directory, and return the offset of its entry
+//	in the directory file, after reading it into "entry".  Return -1
+//	if the name isn't in the directory.
 //
 //	"name" -- the file name to look up
+//	"prev" -- if not NULL, set to the offset of the entry before it
+//		in the same bucket, or 0 if it is the first
 //----------------------------------------------------------------------
 
 int
-Directory::FindIndex(const char *name)
+Directory::FindEntry(const char *name, DirectoryEntry *entry, int *prev)
 {
-    for (int i = 0; i < tableSize; i++)
-        if (table[i].inUse && !strncmp(table[i].name, name, FileNameMaxLen))
-	    return i;
+    char found[FileNameMaxLen + 1];
+    int offset, previous = 0;
+
+    file->ReadAt((char *)&offset, sizeof(int),
+		BucketOffset(Hash(name) % hdr.numBuckets));
+    while (offset != 0) {
+	ReadEntry(offset, entry, found);
+	if (!strcmp(found, name)) {
+	    if (prev != NULL)
+		*prev = previous;
+	    return offset;
+	}
+	previous = offset;
+	offset = entry->next;
+    }
     return -1;		// name not in directory
 }
 
 //----------------------------------------------------------------------
 // Directory::Find
 // 	Look up file name in directory, and return the disk sector number
-//	where the file's header is stored. Return -1 if the name isn't 
+//	where the file's header is stored. Return -1 if the name isn't
 //	in the directory.
 //
 //	"name" -- the file name to look up
+//	"isDirectory" -- if not NULL, set to whether the file is a
+//		directory
 //----------------------------------------------------------------------
 
 int
-Directory::Find(const char *name)
+Directory::Find(const char *name, bool *isDirectory)
 {
-    int i = FindIndex(name);
+    DirectoryEntry entry;
 
-    if (i != -1)
-	return table[i].sector;
-    return -1;
+    if (FindEntry(name, &entry, NULL) == -1)
+	return -1;
+    if (isDirectory != NULL)
+	*isDirectory = entry.isDirectory;
+    return entry.sector;
 }
 
 //----------------------------------------------------------------------
 // Directory::Add
 // 	Add a file into the directory.  Return true if successful;
-//	return false if the file name is already in the directory, or if
-//	the directory is completely full, and has no more space for
-//	additional file names.
+//	return false if the file name is already in the directory, if it
+//	is empty or too long, or if there is no space on disk for the
+//	directory to grow.
 //
 //	"name" -- the name of the file being added
 //	"newSector" -- the disk sector containing the added file's header
+//	"isDirectory" -- is the file a directory?
 //----------------------------------------------------------------------
 
 bool
-Directory::Add(const char *name, int newSector)
-{ 
-    if (FindIndex(name) != -1)
+Directory::Add(const char *name, int newSector, bool isDirectory)
+{
+    int nameLen = strlen(name);
+    int size = EntrySize(nameLen);
+    int bucket;
+    DirectoryEntry *entry;
+    char *image;
+
+    if (nameLen == 0 || nameLen > FileNameMaxLen)
 	return false;
+    image = new char[size];
+    entry = (DirectoryEntry *) image;
+    if (FindEntry(name, entry, NULL) != -1) {
+	delete [] image;
+	return false;
+    }
 
-    for (int i = 0; i < tableSize; i++)
-        if (!table[i].inUse) {
-            table[i].inUse = true;
-            strncpy(table[i].name, name, FileNameMaxLen); 
-            table[i].sector = newSector;
-        return true;
-	}
-    return false;	// no space.  Fix when we have extensible files.
+    // if there is no space to rehash, the chains just get longer
+    if (hdr.numEntries >= MaxLoad * hdr.numBuckets)
+	Rehash(2 * hdr.numBuckets);
+    if (!file->Reserve(hdr.end + size)) {
+	delete [] image;
+	return false;			// no space on disk
+    }
+
+    bzero(image, size);
+    bucket = Hash(name) % hdr.numBuckets;
+    file->ReadAt((char *)&entry->next, sizeof(int), BucketOffset(bucket));
+    entry->sector = newSector;
+    entry->nameLen = nameLen;
+    entry->isDirectory = isDirectory;
+    bcopy(name, image + sizeof(DirectoryEntry), nameLen);
+    file->WriteAt(image, size, hdr.end);
+    file->WriteAt((char *)&hdr.end, sizeof(int), BucketOffset(bucket));
+    hdr.end += size;
+    hdr.numEntries++;
+    WriteHeader();
+    delete [] image;
+    return true;
 }
 
 //----------------------------------------------------------------------
 // Directory::Remove
 // 	Remove a file name from the directory.  Return true if successful;
-//	return false if the file isn't in the directory. 
+//	return false if the file isn't in the directory.
 //
 //	"name" -- the file name to be removed
 //----------------------------------------------------------------------
 
 bool
 Directory::Remove(const char *name)
-{ 
-    int i = FindIndex(name);
+{
+    DirectoryEntry entry;
+    int prev;
 
-    if (i == -1)
+    if (FindEntry(name, &entry, &prev) == -1)
 	return false; 		// name not in directory
-    table[i].inUse = false;
-    return true;	
+
+    // "next" is the first field of an entry, so it is at "prev"
+    if (prev == 0)
+	prev = BucketOffset(Hash(name) % hdr.numBuckets);
+    file->WriteAt((char *)&entry.next, sizeof(int), prev);
+    hdr.numEntries--;
+    hdr.unused += EntrySize(entry.nameLen);
+    WriteHeader();
+    if (hdr.unused > hdr.end / 2)
+	Rehash(hdr.numBuckets);		// take the space back
+    return true;
+}
+
+//----------------------------------------------------------------------
+// Directory::Rehash
+// 	Rewrite the directory file with "numBuckets" buckets, followed by
+//	the entries in use, one after the other.  Return false, changing
+//	nothing, if the file would have to grow and there is no space.
+//----------------------------------------------------------------------
+
+bool
+Directory::Rehash(int numBuckets)
+{
+    int numEntries = hdr.numEntries;
+    DirectoryEntry *entries = new DirectoryEntry[numEntries];
+    char **names = new char *[numEntries];
+    DirectoryEntry entry;
+    char name[FileNameMaxLen + 1];
+    int size = BucketOffset(numBuckets);
+    int i, offset, bucket;
+    bool success;
+
+    for (i = 0, offset = NextEntry(0, &entry, name); offset != 0;
+		i++, offset = NextEntry(offset, &entry, name)) {
+	ASSERT(i < numEntries);
+	entries[i] = entry;
+	names[i] = new char[entry.nameLen + 1];
+	strcpy(names[i], name);
+	size += EntrySize(entry.nameLen);
+    }
+    ASSERT(i == numEntries);
+
+    success = file->Reserve(size);
+    if (success) {
+	char *image = new char[size];
+	int *buckets = (int *)(image + sizeof(DirectoryHeader));
+
+	DEBUG('f', "Rehashing directory: %d entries in %d buckets.\n",
+		numEntries, numBuckets);
+	bzero(image, size);
+	hdr.numBuckets = numBuckets;
+	hdr.end = BucketOffset(numBuckets);
+	hdr.unused = 0;
+	for (i = 0; i < numEntries; i++) {
+	    bucket = Hash(names[i]) % numBuckets;
+	    entries[i].next = buckets[bucket];
+	    buckets[bucket] = hdr.end;
+	    bcopy((char *)&entries[i], image + hdr.end, sizeof(DirectoryEntry));
+	    bcopy(names[i], image + hdr.end + sizeof(DirectoryEntry),
+			entries[i].nameLen);
+	    hdr.end += EntrySize(entries[i].nameLen);
+	}
+	bcopy((char *)&hdr, image, sizeof(DirectoryHeader));
+	file->WriteAt(image, size, 0);
+	delete [] image;
+    }
+
+    for (i = 0; i < numEntries; i++)
+	delete [] names[i];
+    delete [] names;
+    delete [] entries;
+    return success;
+}
+
+//----------------------------------------------------------------------
+// Directory::WriteHeader
+// 	Write the in-memory copy of the directory header to the file.
+//----------------------------------------------------------------------
+
+void
+Directory::WriteHeader()
+{
+    file->WriteAt((char *)&hdr, sizeof(DirectoryHeader), 0);
 }
 
 //----------------------------------------------------------------------
 // Directory::List
-// 	List all the file names in the directory. 
+// 	List all the file names in the directory, and in the directories
+//	in it, each after "path"; the names of directories end in '/'.
 //----------------------------------------------------------------------
 
 void
-Directory::List()
+Directory::List(const char *path)
 {
-   for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse)
-	    printf("%s\n", table[i].name);
+    DirectoryEntry entry;
+    char name[FileNameMaxLen + 1];
+    char *subPath;
+
+    for (int offset = NextEntry(0, &entry, name); offset != 0;
+		offset = NextEntry(offset, &entry, name)) {
+	if (!entry.isDirectory) {
+	    printf("%s%s\n", path, name);
+	    continue;
+	}
+	printf("%s%s/\n", path, name);
+	subPath = new char[strlen(path) + entry.nameLen + 2];
+	sprintf(subPath, "%s%s/", path, name);
+	Directory *dir = new Directory(entry.sector);
+	dir->List(subPath);
+	delete dir;
+	delete [] subPath;
+    }
 }
 
 //----------------------------------------------------------------------
 // Directory::Print
-// 	List all the file names in the directory, their FileHeader locations,
-//	and the contents of each file.  For debugging.
+// 	List all the file names in the directory, and in the directories
+//	in it, their FileHeader locations, and the contents of each file.
+//	For debugging.
 //----------------------------------------------------------------------
 
 void
-Directory::Print()
-{ 
-    FileHeader *hdr = new FileHeader;
-
-    printf("Directory contents:\n");
-    for (int i = 0; i < tableSize; i++)
-	if (table[i].inUse) {
-	    printf("Name: %s, Sector: %d\n", table[i].name, table[i].sector);
-	    hdr->FetchFrom(table[i].sector);
-	    hdr->Print();
+Directory::Print(const char *path)
+{
+    FileHeader *fileHdr = new FileHeader;
+    DirectoryEntry entry;
+    char name[FileNameMaxLen + 1];
+    char *subPath;
+
+    if (*path == '\0')
+	printf("Directory contents:\n");
+    for (int offset = NextEntry(0, &entry, name); offset != 0;
+		offset = NextEntry(offset, &entry, name)) {
+	printf("Name: %s%s%s, Sector: %d\n", path, name,
+		entry.isDirectory ? "/" : "", entry.sector);
+	fileHdr->FetchFrom(entry.sector);
+	fileHdr->Print();
+	if (entry.isDirectory) {
+	    subPath = new char[strlen(path) + entry.nameLen + 2];
+	    sprintf(subPath, "%s%s/", path, name);
+	    Directory *dir = new Directory(entry.sector);
+	    dir->Print(subPath);
+	    delete dir;
+	    delete [] subPath;
+	}
+    }
+    if (*path == '\0')
+	printf("\n");
+    delete fileHdr;
+}
+
+//----------------------------------------------------------------------
+// Directory::PrintExtents
+// 	Print the size of each file in the directory, and in the
+//	directories in it, and how many runs of consecutive sectors it is
+//	in; and add to the number of files and of extents.
+//----------------------------------------------------------------------
+
+void
+Directory::PrintExtents(const char *path, int *numFiles, int *numExtents)
+{
+    FileHeader *fileHdr = new FileHeader;
+    DirectoryEntry entry;
+    char name[FileNameMaxLen + 1];
+    char *subPath;
+    int extents;
+
+    for (int offset = NextEntry(0, &entry, name); offset != 0;
+		offset = NextEntry(offset, &entry, name)) {
+	fileHdr->FetchFrom(entry.sector);
+	extents = fileHdr->CountExtents();
+	printf("%s%s%s: %d bytes in %d extents\n", path, name,
+		entry.isDirectory ? "/" : "", fileHdr->FileLength(), extents);
+	(*numFiles)++;
+	*numExtents += extents;
+	if (entry.isDirectory) {
+	    subPath = new char[strlen(path) + entry.nameLen + 2];
+	    sprintf(subPath, "%s%s/", path, name);
+	    Directory *dir = new Directory(entry.sector);
+	    dir->PrintExtents(subPath, numFiles, numExtents);
+	    delete dir;
+	    delete [] subPath;
 	}
-    printf("\n");
-    delete hdr;
+    }
+    delete fileHdr;
 }
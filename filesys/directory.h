@@ -1,15 +1,20 @@
-// directory.h 
+// directory.h
 //	Data structures to manage a UNIX-like directory of file names.
-// 
+//
 //      A directory is a table of pairs: <file name, sector #>,
-//	giving the name of each file in the directory, and 
+//	giving the name of each file in the directory, and
 //	where to find its file header (the data structure describing
-//	where to find the file's data blocks) on disk.
+//	where to find the file's data blocks) on disk.  A file in a
+//	directory may be a directory itself.
+//
+//	The table is a hash table, kept in a Nachos file, and read and
+//	changed in place through the buffer cache, so that looking up
+//	a name reads one bucket of it rather than the whole directory.
 //
 //      We assume mutual exclusion is provided by the caller.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
-// All rights reserved.  See copyright.h for copyright notice and limitation 
+// All rights reserved.  See copyright.h for copyright notice and limitation
 // of liability and disclaimer of warranty provisions.
 
 #include "copyright.h"
@@ -19,66 +24,107 @@
 
 #include "openfile.h"
 
-const int FileNameMaxLen = 9;		// for simplicity, we assume 
-					// file names are <= 9 characters long
+#define FileNameMaxLen 		255	// names are at most this long;
+					// a path may have many of them
+#define InitialBuckets		8	// hash buckets in a new directory
+#define MaxLoad			2	// entries per bucket, on average,
+					// before the buckets are doubled
+
+// The following class defines the header of a directory file.  It is
+// followed in the file by the hash buckets, each the offset in the
+// file of the first entry in the bucket, or 0; and after those, by the
+// entries, each with its name.  New entries go at the end; the space
+// of removed ones is taken back when the directory is rehashed.
+
+class DirectoryHeader {
+  public:
+    int numEntries;			// Names in the directory
+    int numBuckets;			// Size of the hash table
+    int end;				// Where the next entry goes
+    int unused;				// Bytes of removed entries
+    int parent;				// Header sector of the directory
+					// this one is in
+};
 
 // The following class defines a "directory entry", representing a file
-// in the directory.  Each entry gives the name of the file, and where
-// the file's header is to be found on disk.
+// in the directory.  Each entry gives where the file's header is to be
+// found on disk, and is followed in the directory file by the file's
+// name, "nameLen" characters long, padded to a multiple of 4 bytes.
 //
 // Internal data structures kept public so that Directory operations can
 // access them directly.
 
 class DirectoryEntry {
   public:
-    bool inUse;				// Is this directory entry in use?
-    int sector;				// Location on disk to find the 
-					//   FileHeader for this file 
-    char name[FileNameMaxLen + 1];	// Text name for file, with +1 for 
-					// the trailing '\0'
+    int next;				// Offset of the next entry in the
+					//   same hash bucket, or 0
+    int sector;				// Location on disk to find the
+					//   FileHeader for this file
+    short nameLen;			// Length of the name
+    short isDirectory;			// Is the file a directory?
 };
 
 // The following class defines a UNIX-like "directory".  Each entry in
 // the directory describes a file, and where to find it on disk.
 //
-// The directory data structure can be stored in memory, or on disk.
-// When it is on disk, it is stored as a regular Nachos file.
-//
-// The constructor initializes a directory structure in memory; the
-// FetchFrom/WriteBack operations shuffle the directory information
-// from/to disk. 
+// The constructor opens the file that holds the directory, whose
+// header is at a given sector; Initialize makes a new, empty directory
+// in it.  The other operations read and write the file directly.
 
 class Directory {
   public:
-    Directory(int size); 		// Initialize an empty directory
-					// with space for "size" files
-    ~Directory();			// De-allocate the directory
+    Directory(int sector); 		// Open the directory whose file
+					// header is at "sector"
+    ~Directory();			// Close the directory
 
-    void FetchFrom(OpenFile *file);  	// Init directory contents from disk
-    void WriteBack(OpenFile *file);	// Write modifications to 
-					// directory contents back to disk
+    void Initialize(int parentSector);	// Make the directory empty, and
+					// set the directory it is in
 
-    int Find(const char *name);		// Find the sector number of the 
-					// FileHeader for file: "name"
+    int Find(const char *name, bool *isDirectory = NULL);
+					// Find the sector number of the
+					// FileHeader for file: "name",
+					// and whether it is a directory
 
-    bool Add(const char *name, int newSector);
+    bool Add(const char *name, int newSector, bool isDirectory = false);
     					// Add a file name into the directory
 
     bool Remove(const char *name);	// Remove a file from the directory
 
-    void List();			// Print the names of all the files
-					//  in the directory
-    void Print();			// Verbose print of the contents
+    int Parent() { return hdr.parent; }	// The directory this one is in
+    int NumEntries() { return hdr.numEntries; }
+
+    void List(const char *path);	// Print the names of all the files
+					//  in the directory and those in
+					//  it, after "path"
+    void Print(const char *path);	// Verbose print of the contents
 					//  of the directory -- all the file
 					//  names and their contents.
+    void PrintExtents(const char *path, int *numFiles, int *numExtents);
+					// Print how many extents each file
+					//  is in, and add up the totals
 
-  private:
-    int tableSize;			// Number of directory entries
-    DirectoryEntry *table;		// Table of pairs: 
-					// <file name, file header location> 
+    static unsigned Hash(const char *name);
+					// Hash function for file names
 
-    int FindIndex(const char *name);	// Find the index into the directory 
-					//  table corresponding to "name"
+  private:
+    OpenFile *file;			// The directory file
+    DirectoryHeader hdr;		// In-memory copy of its header
+
+    int FindEntry(const char *name, DirectoryEntry *entry, int *prev);
+					// Find the offset of the entry for
+					//  "name" and of the one before it
+    int ReadEntry(int offset, DirectoryEntry *entry, char *name);
+    int NextEntry(int offset, DirectoryEntry *entry, char *name);
+					// Step through all of the entries
+
+    bool Rehash(int numBuckets);	// Rewrite the directory with
+					//  "numBuckets" buckets
+    void WriteHeader();			// Write "hdr" back to the file
+
+    int BucketOffset(int bucket)
+	{ return sizeof(DirectoryHeader) + bucket * sizeof(int); }
+    static int EntrySize(int nameLen)
+	{ return sizeof(DirectoryEntry) + (nameLen + 3) / 4 * 4; }
 };
 
 #endif // DIRECTORY_H
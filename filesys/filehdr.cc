@@ -3,12 +3,13 @@
 //	would be called the i-node).
 //
 //	The file header is used to locate where on disk the 
-//	file's data is stored.  We implement this as a fixed size
-//	table of pointers -- each entry in the table points to the 
-//	disk sector containing that portion of the file data
-//	(in other words, there are no indirect or doubly indirect 
-//	blocks). The table size is chosen so that the file header
-//	will be just big enough to fit in one disk sector, 
+//	file's data is stored.  We implement this as a list of extents
+//	-- each one a run of consecutive disk sectors holding that
+//	portion of the file data -- followed, for files in too many
+//	pieces, by a table of pointers to single sectors, kept in a
+//	single indirect block, and in the indirect blocks of a double
+//	indirect block.  The file header itself is just big enough to
+//	fit in one disk sector.
 //
 //      Unlike in a real system, we do not keep track of file permissions, 
 //	ownership, last modification date, etc., in the file header. 
@@ -27,33 +28,216 @@
 #include "system.h"
 #include "filehdr.h"
 
+//----------------------------------------------------------------------
+// FileHeader::FileHeader
+// 	Initialize an empty file header; it gets its contents by
+//	allocating blocks for a new file, or by being read from disk.
+//----------------------------------------------------------------------
+
+FileHeader::FileHeader()
+{
+    ASSERT(sizeof(RawFileHeader) == SectorSize);
+    raw.numBytes = raw.numSectors = 0;
+    raw.numExtents = raw.numExtentSectors = 0;
+    raw.singleIndirect = raw.doubleIndirect = -1;
+    for (int i = 0; i < NumIndirect; i++)
+	indirectSectors[i] = -1;
+    table = NULL;
+    headerSector = -1;
+    indexChanged = false;
+}
+
+FileHeader::~FileHeader()
+{
+    delete [] table;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::NumIndexSectors
+// 	Return how many indirect blocks (single, double, and those the
+//	double indirect block points to) it takes to list "numPointers"
+//	sectors one by one.
+//----------------------------------------------------------------------
+
+int
+FileHeader::NumIndexSectors(int numPointers)
+{
+    if (numPointers <= 0)
+	return 0;
+    if (numPointers <= NumIndirect)
+	return 1;
+    return 2 + divRoundUp(numPointers - NumIndirect, NumIndirect);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::AllocateRun
+// 	Allocate a run of "want" consecutive free sectors, within a single
+//	track if it fits in one, or starting at the beginning of a track
+//	if not.  Failing that, take "want" consecutive sectors anywhere,
+//	and failing that, the longest run there is.  Return the first
+//	sector of the run, and its length in "*count", or -1 if the disk
+//	is full.
+//----------------------------------------------------------------------
+
+int
+FileHeader::AllocateRun(BitMap *freeMap, int want, int *count)
+{
+    int start = freeMap->FindRunAligned(want, SectorsPerTrack);
+
+    if (start != -1) {
+	*count = want;
+	return start;
+    }
+    return freeMap->FindLargestRun(want, count);
+}
+
+//----------------------------------------------------------------------
+// FileHeader::AddRun
+// 	Add the "count" sectors from "start" on to the end of the file's
+//	table of data sectors.  While no sector is listed in the indirect
+//	blocks, they also go in the extents: in the last one, if they
+//	continue it, or in a new one, if there is room.
+//----------------------------------------------------------------------
+
+void
+FileHeader::AddRun(int start, int count)
+{
+    if (raw.numExtentSectors == raw.numSectors) {
+	Extent *last = &raw.extents[raw.numExtents > 0 ? raw.numExtents - 1 : 0];
+	if (raw.numExtents > 0 && last->start + last->length == start) {
+	    last->length += count;
+	    raw.numExtentSectors += count;
+	} else if (raw.numExtents < NumExtents) {
+	    raw.extents[raw.numExtents].start = start;
+	    raw.extents[raw.numExtents].length = count;
+	    raw.numExtents++;
+	    raw.numExtentSectors += count;
+	}
+    }
+    for (int i = 0; i < count; i++)
+	table[raw.numSectors++] = start + i;
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Allocate
 // 	Initialize a fresh file header for a newly created file.
-//	Allocate data blocks for the file out of the map of free disk blocks.
-//	Return false if there are not enough free blocks to accomodate
-//	the new file.
+//	Allocate data blocks for the file, run by run, and the indirect
+//	blocks needed to list those not in the extents, out of the map
+//	of free disk blocks.  Return false if there are not enough free
+//	blocks to accomodate the new file.
 //
 //	"freeMap" is the bit map of free disk sectors
-//	"fileSize" is the bit map of free disk sectors
+//	"fileSize" is the size of the new file, in bytes
 //----------------------------------------------------------------------
 
 bool
 FileHeader::Allocate(BitMap *freeMap, int fileSize)
 { 
-    numBytes = fileSize;
-    numSectors  = divRoundUp(fileSize, SectorSize);
-    if (freeMap->NumClear() < numSectors)
+    if (!AddSectors(freeMap, divRoundUp(fileSize, SectorSize)))
 	return false;		// not enough space
+    raw.numBytes = fileSize;
+    return true;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::AddSectors
+// 	Allocate "count" more data sectors for the file, continuing its
+//	last run while the sectors after it are free, and in new runs
+//	after that; and the indirect blocks needed to list those that are
+//	not in the extents.  Return false, allocating nothing, if there
+//	may not be enough free sectors.
+//----------------------------------------------------------------------
+
+bool
+FileHeader::AddSectors(BitMap *freeMap, int count)
+{
+    int oldPointers = raw.numSectors - raw.numExtentSectors;
+    int numSectors = raw.numSectors + count;
+    int numPointers, start, run, i;
+    int *oldTable = table;
+
+    // in the worst case, none of the new sectors goes in an extent
+    if (freeMap->NumClear() < count + NumIndexSectors(oldPointers + count)
+				- NumIndexSectors(oldPointers))
+	return false;
+
+    table = new int[numSectors];
+    for (i = 0; i < raw.numSectors; i++)
+	table[i] = oldTable[i];
+    delete [] oldTable;
+
+    while (raw.numSectors < numSectors) {
+	start = (raw.numSectors > 0) ? table[raw.numSectors - 1] + 1
+				     : NumSectors;
+	for (run = 0; run < numSectors - raw.numSectors
+		&& start + run < NumSectors && !freeMap->Test(start + run);
+		run++)
+	    freeMap->Mark(start + run);
+	if (run == 0) {
+	    start = AllocateRun(freeMap, numSectors - raw.numSectors, &run);
+	    ASSERT(start != -1);
+	}
+	AddRun(start, run);
+    }
 
-    for (int i = 0; i < numSectors; i++)
-	dataSectors[i] = freeMap->Find();
+    numPointers = numSectors - raw.numExtentSectors;
+    if (numPointers > 0 && raw.singleIndirect == -1)
+	raw.singleIndirect = freeMap->Find();
+    if (numPointers > NumIndirect && raw.doubleIndirect == -1)
+	raw.doubleIndirect = freeMap->Find();
+    for (i = 0; i < NumIndirect; i++)
+	if ((i + 1) * NumIndirect < numPointers && indirectSectors[i] == -1)
+	    indirectSectors[i] = freeMap->Find();
+    indexChanged = true;
+    DEBUG('f', "Allocated %d sectors, now %d in %d extents and %d pointers.\n",
+		count, numSectors, raw.numExtents, numPointers);
     return true;
 }
 
+//----------------------------------------------------------------------
+// FileHeader::Grow
+// 	Make the file "fileSize" bytes long, unless it is longer already.
+//	If it needs more sectors, allocate GrowChunk of them at least, so
+//	that the next few writes past the end find them there; if that
+//	many are not free, just those needed.  Return false if there is
+//	not enough space even for those.
+//
+//	"freeMap" is the bit map of free disk sectors
+//	"fileSize" is the new size of the file, in bytes
+//----------------------------------------------------------------------
+
+bool
+FileHeader::Grow(BitMap *freeMap, int fileSize)
+{
+    int needed = divRoundUp(fileSize, SectorSize) - raw.numSectors;
+
+    if (needed > 0 && !(needed < GrowChunk && AddSectors(freeMap, GrowChunk))
+		&& !AddSectors(freeMap, needed))
+	return false;
+    if (fileSize > raw.numBytes)
+	raw.numBytes = fileSize;
+    return true;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::Reserve
+// 	Allocate the sectors the file needs to grow to "fileSize" bytes,
+//	without changing its length.  Return false if there is not enough
+//	space.
+//----------------------------------------------------------------------
+
+bool
+FileHeader::Reserve(BitMap *freeMap, int fileSize)
+{
+    int needed = divRoundUp(fileSize, SectorSize) - raw.numSectors;
+
+    return needed <= 0 || AddSectors(freeMap, needed);
+}
+
 //----------------------------------------------------------------------
 // FileHeader::Deallocate
-// 	De-allocate all the space allocated for data blocks for this file.
+// 	De-allocate all the space allocated for data blocks for this file,
+//	and for the indirect blocks pointing to them.
 //
 //	"freeMap" is the bit map of free disk sectors
 //----------------------------------------------------------------------
@@ -61,15 +245,27 @@ FileHeader::Allocate(BitMap *freeMap, int fileSize)
 void 
 FileHeader::Deallocate(BitMap *freeMap)
 {
-    for (int i = 0; i < numSectors; i++) {
-	ASSERT(freeMap->Test((int) dataSectors[i]));  // ought to be marked!
-	freeMap->Clear((int) dataSectors[i]);
+    int i;
+
+    for (i = 0; i < raw.numSectors; i++) {
+	ASSERT(freeMap->Test(table[i]));  // ought to be marked!
+	freeMap->Clear(table[i]);
     }
+    if (raw.singleIndirect != -1)
+	freeMap->Clear(raw.singleIndirect);
+    if (raw.doubleIndirect != -1)
+	freeMap->Clear(raw.doubleIndirect);
+    for (i = 0; i < NumIndirect; i++)
+	if (indirectSectors[i] != -1)
+	    freeMap->Clear(indirectSectors[i]);
 }
 
 //----------------------------------------------------------------------
 // FileHeader::FetchFrom
-// 	Fetch contents of file header from disk. 
+// 	Fetch contents of file header from disk, and build the table of
+//	data blocks from the extents and the indirect blocks.  If the
+//	header was fetched before, and no sectors were added to the file
+//	since, the table is still good, and only the length may change.
 //
 //	"sector" is the disk sector containing the file header
 //----------------------------------------------------------------------
@@ -77,12 +273,38 @@ FileHeader::Deallocate(BitMap *freeMap)
 void
 FileHeader::FetchFrom(int sector)
 {
-    synchDisk->ReadSector(sector, (char *)this);
+    int numSectors = raw.numSectors;
+    int i, j, k;
+
+    bufferCache->ReadSector(sector, (char *) &raw);
+    if (table != NULL && sector == headerSector && raw.numSectors == numSectors)
+	return;
+    headerSector = sector;
+    delete [] table;
+    table = new int[raw.numSectors];
+    for (i = k = 0; i < raw.numExtents; i++)
+	for (j = 0; j < raw.extents[i].length; j++)
+	    table[k++] = raw.extents[i].start + j;
+    ASSERT(k == raw.numExtentSectors);
+    if (raw.singleIndirect != -1)
+	FetchIndirect(raw.singleIndirect, raw.numExtentSectors);
+    if (raw.doubleIndirect != -1) {
+	bufferCache->ReadSector(raw.doubleIndirect, (char *) indirectSectors);
+	for (i = 0; i < NumIndirect; i++)
+	    if (indirectSectors[i] != -1)
+		FetchIndirect(indirectSectors[i],
+			raw.numExtentSectors + (i + 1) * NumIndirect);
+    } else {
+	for (i = 0; i < NumIndirect; i++)
+	    indirectSectors[i] = -1;
+    }
 }
 
 //----------------------------------------------------------------------
 // FileHeader::WriteBack
-// 	Write the modified contents of the file header back to disk. 
+// 	Write the modified contents of the file header back to disk,
+//	together with the indirect blocks if sectors were added to the
+//	file since they were last written.
 //
 //	"sector" is the disk sector to contain the file header
 //----------------------------------------------------------------------
@@ -90,7 +312,46 @@ FileHeader::FetchFrom(int sector)
 void
 FileHeader::WriteBack(int sector)
 {
-    synchDisk->WriteSector(sector, (char *)this); 
+    bufferCache->WriteSector(sector, (char *) &raw); 
+    headerSector = sector;
+    if (!indexChanged)
+	return;
+    indexChanged = false;
+    if (raw.singleIndirect != -1)
+	WriteIndirect(raw.singleIndirect, raw.numExtentSectors);
+    if (raw.doubleIndirect != -1) {
+	bufferCache->WriteSector(raw.doubleIndirect, (char *) indirectSectors);
+	for (int i = 0; i < NumIndirect; i++)
+	    if (indirectSectors[i] != -1)
+		WriteIndirect(indirectSectors[i],
+			raw.numExtentSectors + (i + 1) * NumIndirect);
+    }
+}
+
+//----------------------------------------------------------------------
+// FileHeader::FetchIndirect/WriteIndirect
+// 	Read/write the indirect block at "sector", which holds the entries
+//	of the table of data blocks from "first" on.
+//----------------------------------------------------------------------
+
+void
+FileHeader::FetchIndirect(int sector, int first)
+{
+    int block[NumIndirect];
+
+    bufferCache->ReadSector(sector, (char *) block);
+    for (int i = 0; i < NumIndirect && first + i < raw.numSectors; i++)
+	table[first + i] = block[i];
+}
+
+void
+FileHeader::WriteIndirect(int sector, int first)
+{
+    int block[NumIndirect];
+
+    for (int i = 0; i < NumIndirect; i++)
+	block[i] = (first + i < raw.numSectors) ? table[first + i] : -1;
+    bufferCache->WriteSector(sector, (char *) block);
 }
 
 //----------------------------------------------------------------------
@@ -98,7 +359,8 @@ FileHeader::WriteBack(int sector)
 // 	Return which disk sector is storing a particular byte within the file.
 //      This is essentially a translation from a virtual address (the
 //	offset in the file) to a physical address (the sector where the
-//	data at the offset is stored).
+//	data at the offset is stored).  The indirect blocks were read
+//	into the table along with the header, so this is a lookup.
 //
 //	"offset" is the location within the file of the byte in question
 //----------------------------------------------------------------------
@@ -106,7 +368,8 @@ FileHeader::WriteBack(int sector)
 int
 FileHeader::ByteToSector(int offset)
 {
-    return(dataSectors[offset / SectorSize]);
+    ASSERT(offset >= 0 && offset / SectorSize < raw.numSectors);
+    return(table[offset / SectorSize]);
 }
 
 //----------------------------------------------------------------------
@@ -117,7 +380,24 @@ FileHeader::ByteToSector(int offset)
 int
 FileHeader::FileLength()
 {
-    return numBytes;
+    return raw.numBytes;
+}
+
+//----------------------------------------------------------------------
+// FileHeader::CountExtents
+// 	Return the number of runs of consecutive sectors the file's data
+//	is in.  A file in one run reads with at most one seek per track.
+//----------------------------------------------------------------------
+
+int
+FileHeader::CountExtents()
+{
+    int count = 0;
+
+    for (int i = 0; i < raw.numSectors; i++)
+	if (i == 0 || table[i] != table[i - 1] + 1)
+	    count++;
+    return count;
 }
 
 //----------------------------------------------------------------------
@@ -132,13 +412,25 @@ FileHeader::Print()
     int i, j, k;
     char *data = new char[SectorSize];
 
-    printf("FileHeader contents.  File size: %d.  File blocks:\n", numBytes);
-    for (i = 0; i < numSectors; i++)
-	printf("%d ", dataSectors[i]);
+    printf("FileHeader contents.  File size: %d.  File extents:\n",
+		raw.numBytes);
+    for (i = 0; i < raw.numSectors; i = j) {
+	for (j = i + 1; j < raw.numSectors && table[j] == table[j - 1] + 1; j++)
+	    ;
+	printf("%d-%d ", table[i], table[j - 1]);
+    }
+    if (raw.singleIndirect != -1) {
+	printf("\nIndirect blocks: %d", raw.singleIndirect);
+	if (raw.doubleIndirect != -1)
+	    printf(" %d", raw.doubleIndirect);
+	for (i = 0; i < NumIndirect; i++)
+	    if (indirectSectors[i] != -1)
+		printf(" %d", indirectSectors[i]);
+    }
     printf("\nFile contents:\n");
-    for (i = k = 0; i < numSectors; i++) {
-	synchDisk->ReadSector(dataSectors[i], data);
-        for (j = 0; (j < SectorSize) && (k < numBytes); j++, k++) {
+    for (i = k = 0; i < raw.numSectors; i++) {
+	bufferCache->ReadSector(table[i], data);
+        for (j = 0; (j < SectorSize) && (k < raw.numBytes); j++, k++) {
 	    if ('\040' <= data[j] && data[j] <= '\176')   // isprint(data[j])
 		printf("%c", data[j]);
             else
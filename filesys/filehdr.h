@@ -17,31 +17,75 @@
 #include "disk.h"
 #include "bitmap.h"
 
-#define NumDirect	((SectorSize - 2 * sizeof(int)) / sizeof(int))
-#define MaxFileSize	(NumDirect * SectorSize)
+#define NumExtents	((int) ((SectorSize - 6 * sizeof(int)) / sizeof(Extent)))
+#define NumIndirect	((int) (SectorSize / sizeof(int)))
+					// Sector numbers in an indirect block
+#define GrowChunk	(SectorsPerTrack / 4)
+					// Sectors a file grows by, at least
 
 // The following class defines the Nachos "file header" (in UNIX terms,  
 // the "i-node"), describing where on disk to find all of the data in the file.
-// The file header is organized as a simple table of pointers to
-// data blocks. 
 //
-// The file header data structure can be stored in memory or on disk.
-// When it is on disk, it is stored in a single sector -- this means
-// that we assume the size of this data structure to be the same
-// as one disk sector.  Without indirect addressing, this
-// limits the maximum file length to just under 4K bytes.
+// Files are allocated in extents -- runs of consecutive sectors, kept
+// within a track where they fit -- so that reading a file in order
+// seldom needs a seek, and is mostly served from the disk's track
+// buffer.  The file header lists the first NumExtents extents.  If a
+// file is in more pieces than that, the sectors past those extents are
+// listed one by one: the first NumIndirect in a single indirect block,
+// and the rest in the indirect blocks pointed to by a double indirect
+// block.  This allows files as large as the whole disk.
 //
-// There is no constructor; rather the file header can be initialized
-// by allocating blocks for the file (if it is a new file), or by
-// reading it from disk.
+// The part of the file header stored on disk fits in a single sector.
+// In memory, the header also keeps the table of every data block of
+// the file, built from the extents and the indirect blocks when the
+// header is fetched, so that ByteToSector does not need to go to disk.
+//
+// The file header can be initialized by allocating blocks for the file
+// (if it is a new file), or by reading it from disk.
+//
+// Files grow as they are written past their end.  Sectors are added
+// GrowChunk at a time, continuing the last extent when the sectors after
+// it are free, so that a file written a little at a time neither gets a
+// sector at a time nor ends up in pieces.  Space can also be reserved
+// ahead of time, without changing the length of the file.
+
+// A run of consecutive sectors of a file.
+struct Extent {
+    int start;				// First sector of the run
+    int length;				// Number of sectors in it
+};
+
+// The part of a file header stored on disk.
+struct RawFileHeader {
+    int numBytes;			// Number of bytes in the file
+    int numSectors;			// Number of data sectors in the file
+    int numExtents;			// Number of extents in use
+    int numExtentSectors;		// Number of data sectors they hold;
+					// the rest are in indirect blocks
+    Extent extents[NumExtents];		// Where the first data sectors are
+    int singleIndirect;			// Sector of the single indirect
+					// block, or -1
+    int doubleIndirect;			// Sector of the double indirect
+					// block, or -1
+};
 
 class FileHeader {
   public:
+    FileHeader();
+    ~FileHeader();
+
     bool Allocate(BitMap *bitMap, int fileSize);// Initialize a file header, 
 						//  including allocating space 
 						//  on disk for the file data
     void Deallocate(BitMap *bitMap);  		// De-allocate this file's 
 						//  data blocks
+    bool Grow(BitMap *bitMap, int fileSize);	// Make the file "fileSize"
+						//  bytes long, if it is
+						//  shorter, allocating space
+						//  as needed
+    bool Reserve(BitMap *bitMap, int fileSize);	// Allocate space for the
+						//  file to grow to "fileSize"
+						//  bytes
 
     void FetchFrom(int sectorNumber); 	// Initialize file header from disk
     void WriteBack(int sectorNumber); 	// Write modifications to file header
@@ -49,18 +93,47 @@ class FileHeader {
 
     int ByteToSector(int offset);	// Convert a byte offset into the file
 					// to the disk sector containing
-					// the byte
+					// the byte, in constant time
 
     int FileLength();			// Return the length of the file 
 					// in bytes
 
+    int CountExtents();			// Return the number of runs of
+					// consecutive sectors the file is
+					// in, whether or not the header
+					// lists them as extents
+
     void Print();			// Print the contents of the file.
 
   private:
-    int numBytes;			// Number of bytes in the file
-    int numSectors;			// Number of data sectors in the file
-    int dataSectors[NumDirect];		// Disk sector numbers for each data 
+    RawFileHeader raw;			// What is stored on disk
+    int *table;				// Disk sector numbers for each data 
 					// block in the file
+    int indirectSectors[NumIndirect];	// Contents of the double indirect
+					// block: sectors of the indirect
+					// blocks it points to
+    int headerSector;			// Where the header was last read
+					// from or written to, or -1
+    bool indexChanged;			// Sectors were added since the
+					// indirect blocks were written
+
+    bool AddSectors(BitMap *freeMap, int count);
+					// Allocate "count" more data sectors,
+					// and the indirect blocks for them
+
+    void AddRun(int start, int count);	// Add a run of sectors at the end
+					// of the table, and to the extents
+					// if they are not full
+    static int AllocateRun(BitMap *freeMap, int want, int *count);
+					// Allocate up to "want" consecutive
+					// sectors, as few tracks as possible
+    void FetchIndirect(int sector, int first);
+    void WriteIndirect(int sector, int first);
+					// Read/write an indirect block,
+					// holding the table from "first" on
+    static int NumIndexSectors(int numPointers);
+					// How many indirect blocks it takes
+					// to list "numPointers" sectors
 };
 
 #endif // FILEHDR_H
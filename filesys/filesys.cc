@@ -7,34 +7,38 @@
 //		(the size of the file header data structure is arranged
 //		to be precisely the size of 1 disk sector)
 //	   A number of data blocks
-//	   An entry in the file system directory
+//	   An entry in a directory
 //
 // 	The file system consists of several data structures:
 //	   A bitmap of free disk sectors (cf. bitmap.h)
-//	   A directory of file names and file headers
+//	   A tree of directories of file names and file headers,
+//	     starting at the root directory
 //
-//      Both the bitmap and the directory are represented as normal
-//	files.  Their file headers are located in specific sectors
-//	(sector 0 and sector 1), so that the file system can find them 
-//	on bootup.
+//      Both the bitmap and the directories are represented as normal
+//	files.  The file headers of the bitmap and of the root directory
+//	are located in specific sectors (sector 0 and sector 1), so that
+//	the file system can find them on bootup.
 //
-//	The file system assumes that the bitmap and directory files are
-//	kept "open" continuously while Nachos is running.
+//	The file system assumes that the bitmap and root directory files
+//	are kept "open" continuously while Nachos is running.
 //
-//	For those operations (such as Create, Remove) that modify the
-//	directory and/or bitmap, if the operation succeeds, the changes
-//	are written immediately back to disk (the two files are kept
-//	open during all this time).  If the operation fails, and we have
-//	modified part of the directory and/or bitmap, we simply discard
-//	the changed version, without writing it back to disk.
+//	A file is named by a path, as in UNIX: the names of the
+//	directories leading to it from the root, and its own, separated
+//	by '/'.  "." names a directory itself, and ".." the one it is in.
+//	The dentry cache remembers the names looked up recently, so that
+//	resolving a path does not read the directories every time.
+//
+//	The bitmap is also kept in memory, so that allocating sectors
+//	does not read it off disk every time.  Operations (such as
+//	Create, Remove) that modify it mark it dirty, and it is written
+//	back to disk by Sync, which is called when Nachos shuts down.
+//	Directories are changed in place; Sync also flushes the buffer
+//	cache, which holds on to changes to any file.  If an operation
+//	fails, it undoes whatever changes it made.  A lock keeps
+//	concurrent operations from seeing them half changed.
 //
 // 	Our implementation at this point has the following restrictions:
 //
-//	   there is no synchronization for concurrent accesses
-//	   files have a fixed size, set when the file is created
-//	   files cannot be bigger than about 3KB in size
-//	   there is no hierarchical directory structure, and only a limited
-//	     number of files can be added to the system
 //	   there is no attempt to make the system robust to failures
 //	    (if Nachos exits in the middle of an operation that modifies
 //	    the file system, it may corrupt the disk)
@@ -48,41 +52,47 @@
 #include "disk.h"
 #include "bitmap.h"
 #include "directory.h"
+#include "dentrycache.h"
 #include "filehdr.h"
 #include "filesys.h"
+#include "synch.h"
+#include "system.h"
 
 // Sectors containing the file headers for the bitmap of free sectors,
-// and the directory of files.  These file headers are placed in well-known 
+// and the root directory.  These file headers are placed in well-known
 // sectors, so that they can be located on boot-up.
 #define FreeMapSector 		0
 #define DirectorySector 	1
 
-// Initial file sizes for the bitmap and directory; until the file system
-// supports extensible files, the directory size sets the maximum number 
-// of files that can be loaded onto the disk.
+// Initial file sizes for the bitmap and directories; a directory grows
+// as files are added to it.
 #define FreeMapFileSize 	(NumSectors / BitsInByte)
-#define NumDirEntries 		10
-#define DirectoryFileSize 	(sizeof(DirectoryEntry) * NumDirEntries)
+#define DirectoryFileSize 	(sizeof(DirectoryHeader) \
+					+ InitialBuckets * sizeof(int))
 
 //----------------------------------------------------------------------
 // FileSystem::FileSystem
 // 	Initialize the file system.  If format == true, the disk has
 //	nothing on it, and we need to initialize the disk to contain
-//	an empty directory, and a bitmap of free sectors (with almost but
-//	not all of the sectors marked as free).  
+//	an empty root directory, and a bitmap of free sectors (with almost
+//	but not all of the sectors marked as free).
 //
 //	If format == false, we just have to open the files
-//	representing the bitmap and the directory.
+//	representing the bitmap and the root directory, and read the
+//	bitmap into memory.
 //
 //	"format" -- should we initialize the disk?
 //----------------------------------------------------------------------
 
 FileSystem::FileSystem(bool format)
-{ 
+{
     DEBUG('f', "Initializing the file system.\n");
+    lock = new Lock("file system");
+    freeMap = new BitMap(NumSectors);
+    dentries = new DentryCache(NumDentries);
+    freeMapDirty = false;
+
     if (format) {
-        BitMap *freeMap = new BitMap(NumSectors);
-        Directory *directory = new Directory(NumDirEntries);
 	FileHeader *mapHdr = new FileHeader;
 	FileHeader *dirHdr = new FileHeader;
 
@@ -90,7 +100,7 @@ FileSystem::FileSystem(bool format)
 
     // First, allocate space for FileHeaders for the directory and bitmap
     // (make sure no one else grabs these!)
-	freeMap->Mark(FreeMapSector);	    
+	freeMap->Mark(FreeMapSector);
 	freeMap->Mark(DirectorySector);
 
     // Second, allocate space for the data blocks containing the contents
@@ -105,7 +115,7 @@ FileSystem::FileSystem(bool format)
     // on it!).
 
         DEBUG('f', "Writing headers back to disk.\n");
-	mapHdr->WriteBack(FreeMapSector);    
+	mapHdr->WriteBack(FreeMapSector);
 	dirHdr->WriteBack(DirectorySector);
 
     // OK to open the bitmap and directory files now
@@ -113,201 +123,505 @@ FileSystem::FileSystem(bool format)
     // while Nachos is running.
 
         freeMapFile = new OpenFile(FreeMapSector);
-        directoryFile = new OpenFile(DirectorySector);
-     
+        root = new Directory(DirectorySector);
+
     // Once we have the files "open", we can write the initial version
     // of each file back to disk.  The directory at this point is completely
-    // empty; but the bitmap has been changed to reflect the fact that
-    // sectors on the disk have been allocated for the file headers and
-    // to hold the file data for the directory and bitmap.
+    // empty, and it is its own parent; but the bitmap has been changed to
+    // reflect the fact that sectors on the disk have been allocated for
+    // the file headers and to hold the file data for the directory and
+    // bitmap.
 
         DEBUG('f', "Writing bitmap and directory back to disk.\n");
 	freeMap->WriteBack(freeMapFile);	 // flush changes to disk
-	directory->WriteBack(directoryFile);
+	root->Initialize(DirectorySector);
 
 	if (DebugIsEnabled('f')) {
 	    freeMap->Print();
-	    directory->Print();
-
-        delete freeMap; 
-	delete directory; 
-	delete mapHdr; 
-	delete dirHdr;
+	    root->Print("");
 	}
+	delete mapHdr;
+	delete dirHdr;
     } else {
     // if we are not formatting the disk, just open the files representing
-    // the bitmap and directory; these are left open while Nachos is running
+    // the bitmap and the root directory; these are left open while Nachos
+    // is running
         freeMapFile = new OpenFile(FreeMapSector);
-        directoryFile = new OpenFile(DirectorySector);
+        root = new Directory(DirectorySector);
+	freeMap->FetchFrom(freeMapFile);
+    }
+}
+
+//----------------------------------------------------------------------
+// FileSystem::~FileSystem
+// 	Write back the bitmap if it changed, and close the files of the
+//	bitmap and the root directory.
+//----------------------------------------------------------------------
+
+FileSystem::~FileSystem()
+{
+    Sync();
+    delete freeMap;
+    delete root;
+    delete dentries;
+    delete freeMapFile;
+    delete lock;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Sync
+// 	Write the in-memory bitmap back to disk, if it changed since it
+//	was last written, and then everything else the buffer cache has
+//	not written back yet, the directories included.
+//----------------------------------------------------------------------
+
+void
+FileSystem::Sync()
+{
+    lock->Acquire();
+    if (freeMapDirty) {
+	DEBUG('f', "Writing bitmap back to disk.\n");
+	freeMap->WriteBack(freeMapFile);
+	freeMapDirty = false;
+    }
+    bufferCache->Flush();
+    lock->Release();
+}
+
+//----------------------------------------------------------------------
+// FileSystem::OpenDirectory
+// 	Open the directory whose header is at "sector".  The root
+//	directory is open already.
+//----------------------------------------------------------------------
+
+Directory *
+FileSystem::OpenDirectory(int sector)
+{
+    if (sector == DirectorySector)
+	return root;
+    return new Directory(sector);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::CloseDirectory
+// 	Close a directory opened by OpenDirectory, unless it is the root.
+//----------------------------------------------------------------------
+
+void
+FileSystem::CloseDirectory(Directory *dir)
+{
+    if (dir != root)
+	delete dir;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::LookupIn
+// 	Look up "name" in the directory whose header is at "dirSector",
+//	in the dentry cache first, and return the sector of its header;
+//	or -1 if it is not there.  ".." is the directory "dirSector" is
+//	in.  Done with the lock held.
+//
+//	"isDirectory" -- set to whether "name" is a directory
+//----------------------------------------------------------------------
+
+int
+FileSystem::LookupIn(int dirSector, const char *name, bool *isDirectory)
+{
+    Directory *dir;
+    int sector;
+
+    stats->numNameLookups++;
+    sector = dentries->Lookup(dirSector, name, isDirectory);
+    if (sector != -1) {
+	stats->numDentryHits++;
+	return sector;
     }
+
+    dir = OpenDirectory(dirSector);
+    if (!strcmp(name, "..")) {
+	sector = dir->Parent();
+	*isDirectory = true;
+    } else
+	sector = dir->Find(name, isDirectory);
+    CloseDirectory(dir);
+    if (sector != -1)
+	dentries->Enter(dirSector, name, sector, *isDirectory);
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Resolve
+// 	Follow "path" from the root directory, and return the sector of
+//	the header of the file or directory it names; or -1 if there is
+//	none.  Empty names and "." are skipped, so that "/" and "" both
+//	name the root.  Done with the lock held.
+//
+//	"isDirectory" -- set to whether the path names a directory
+//----------------------------------------------------------------------
+
+int
+FileSystem::Resolve(const char *path, bool *isDirectory)
+{
+    char name[FileNameMaxLen + 1];
+    int sector = DirectorySector;
+    int len;
+
+    *isDirectory = true;
+    while (*path != '\0') {
+	for (len = 0; path[len] != '\0' && path[len] != '/'; len++)
+	    ;
+	if (len > FileNameMaxLen)
+	    return -1;			// name too long
+	strncpy(name, path, len);
+	name[len] = '\0';
+	path += (path[len] == '/') ? len + 1 : len;
+
+	if (len == 0)
+	    continue;
+	if (!*isDirectory)
+	    return -1;			// a file has nothing in it
+	if (!strcmp(name, "."))
+	    continue;
+	sector = LookupIn(sector, name, isDirectory);
+	if (sector == -1)
+	    return -1;			// name not found
+    }
+    return sector;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::ResolveParent
+// 	Split "path" into the directory it is in and its last name, and
+//	return the sector of the header of that directory; or -1 if there
+//	is no such directory, or no last name, or if it is "." or "..",
+//	which cannot be created or removed.  Done with the lock held.
+//
+//	"name" -- set to the last name in the path; must have room for
+//		FileNameMaxLen + 1 characters
+//----------------------------------------------------------------------
+
+int
+FileSystem::ResolveParent(const char *path, char *name)
+{
+    int end = strlen(path), start, sector;
+    bool isDirectory;
+    char *dirPath;
+
+    while (end > 0 && path[end - 1] == '/')
+	end--;				// "a/b/" is "a/b"
+    for (start = end; start > 0 && path[start - 1] != '/'; start--)
+	;
+    if (start == end || end - start > FileNameMaxLen)
+	return -1;
+    strncpy(name, path + start, end - start);
+    name[end - start] = '\0';
+    if (!strcmp(name, ".") || !strcmp(name, ".."))
+	return -1;
+
+    dirPath = new char[start + 1];
+    strncpy(dirPath, path, start);
+    dirPath[start] = '\0';
+    sector = Resolve(dirPath, &isDirectory);
+    delete [] dirPath;
+    if (sector == -1 || !isDirectory)
+	return -1;
+    return sector;
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Create
 // 	Create a file in the Nachos file system (similar to UNIX create).
-//	Since we can't increase the size of files dynamically, we have
-//	to give Create the initial size of the file.
+//	Files grow as they are written past the end, so the initial
+//	size may be 0; a larger one allocates the space up front.
 //
 //	The steps to create a file are:
+//	  Find the directory it goes in
 //	  Make sure the file doesn't already exist
 //        Allocate a sector for the file header
 // 	  Allocate space on disk for the data blocks for the file
+//	  Store the new file header on disk
+//	  If it is a directory, write an empty directory in it
 //	  Add the name to the directory
-//	  Store the new file header on disk 
-//	  Flush the changes to the bitmap and the directory back to disk
+//	  Mark the bitmap as changed
 //
 //	Return true if everything goes ok, otherwise, return false.
 //
 // 	Create fails if:
+//		the directory it goes in does not exist
 //   		file is already in directory
 //	 	no free space for file header
-//	 	no free entry for file in directory
-//	 	no free space for data blocks for the file 
+//	 	no free space for data blocks for the file
+//	 	no free space for the directory to grow
 //
-// 	Note that this implementation assumes there is no concurrent access
-//	to the file system!
-//
-//	"name" -- name of file to be created
+//	"name" -- path of file to be created
 //	"initialSize" -- size of file to be created
 //----------------------------------------------------------------------
 
 bool
 FileSystem::Create(const char *name, int initialSize)
 {
-    Directory *directory;
-    BitMap *freeMap;
-    FileHeader *hdr;
-    int sector;
-    bool success;
-
     DEBUG('f', "Creating file %s, size %d\n", name, initialSize);
+    return AddFile(name, initialSize, false);
+}
 
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
+//----------------------------------------------------------------------
+// FileSystem::MakeDirectory
+// 	Create an empty directory (similar to UNIX mkdir).  Fails in the
+//	same cases as Create.
+//
+//	"name" -- path of directory to be created
+//----------------------------------------------------------------------
+
+bool
+FileSystem::MakeDirectory(const char *name)
+{
+    DEBUG('f', "Creating directory %s\n", name);
+    return AddFile(name, DirectoryFileSize, true);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::AddFile
+// 	Create a file or a directory, as described for Create.
+//----------------------------------------------------------------------
+
+bool
+FileSystem::AddFile(const char *path, int initialSize, bool isDirectory)
+{
+    char name[FileNameMaxLen + 1];
+    Directory *dir;
+    FileHeader *hdr;
+    int dirSector, sector;
+    bool success;
 
-    if (directory->Find(name) != -1)
+    lock->Acquire();
+    dirSector = ResolveParent(path, name);
+    if (dirSector == -1) {
+	lock->Release();
+	return false;			// no directory to put it in
+    }
+    dir = OpenDirectory(dirSector);
+    if (dir->Find(name) != -1)
       success = false;			// file is already in directory
-    else {	
-        freeMap = new BitMap(NumSectors);
-        freeMap->FetchFrom(freeMapFile);
+    else {
         sector = freeMap->Find();	// find a sector to hold the file header
-    	if (sector == -1) 		
-            success = false;		// no free block for file header 
-        else if (!directory->Add(name, sector))
-            success = false;	// no space in directory
-	else {
+    	if (sector == -1)
+            success = false;		// no free block for file header
+        else {
     	    hdr = new FileHeader;
-	    if (!hdr->Allocate(freeMap, initialSize))
+	    if (!hdr->Allocate(freeMap, initialSize)) {
             	success = false;	// no space on disk for data
-	    else {	
-	    	success = true;
-		// everthing worked, flush all changes back to disk
-    	    	hdr->WriteBack(sector); 		
-    	    	directory->WriteBack(directoryFile);
-    	    	freeMap->WriteBack(freeMapFile);
+		freeMap->Clear(sector);
+	    } else {
+    	    	hdr->WriteBack(sector);
+		if (isDirectory) {
+		    Directory *newDir = new Directory(sector);
+		    newDir->Initialize(dirSector);
+		    delete newDir;
+		}
+		if (!dir->Add(name, sector, isDirectory)) {
+		    success = false;	// no space for the directory to grow
+		    hdr->Deallocate(freeMap);
+		    freeMap->Clear(sector);
+		} else {
+		    // everthing worked; the header and the directory are in
+		    // the buffer cache, the bitmap goes to disk on Sync
+		    success = true;
+		    freeMapDirty = true;
+		}
 	    }
             delete hdr;
 	}
-        delete freeMap;
     }
-    delete directory;
+    CloseDirectory(dir);
+    lock->Release();
     return success;
 }
 
+//----------------------------------------------------------------------
+// FileSystem::Extend
+// 	Make sure the file whose header is at "sector" has the space to
+//	hold "numBytes" bytes, allocating sectors from the bitmap; and if
+//	"grow" is true, make it "numBytes" bytes long, if it is shorter.
+//	The header on disk is read first, since another open file may
+//	have changed it, and written back after.  A directory grows while
+//	the caller holds the lock already.
+//
+//	Return false if there is not enough free space on the disk.
+//
+//	"sector" -- where the file header is on disk
+//	"hdr" -- the in-memory copy of the header, kept up to date
+//	"numBytes" -- the size to make space for
+//	"grow" -- should the length of the file change?
+//----------------------------------------------------------------------
+
+bool
+FileSystem::Extend(int sector, FileHeader *hdr, int numBytes, bool grow)
+{
+    bool held = lock->isHeldByCurrentThread();
+    bool success;
+
+    if (!held)
+	lock->Acquire();
+    hdr->FetchFrom(sector);
+    if (grow)
+	success = hdr->Grow(freeMap, numBytes);
+    else
+	success = hdr->Reserve(freeMap, numBytes);
+    if (success) {
+	hdr->WriteBack(sector);
+	freeMapDirty = true;
+    }
+    if (!held)
+	lock->Release();
+    return success;
+}
+
+//----------------------------------------------------------------------
+// FileSystem::Reload
+// 	Read the file header at "sector" into "hdr" again.  Done while
+//	no other thread is changing it; the lock may be held already,
+//	when reading a directory.
+//----------------------------------------------------------------------
+
+void
+FileSystem::Reload(int sector, FileHeader *hdr)
+{
+    bool held = lock->isHeldByCurrentThread();
+
+    if (!held)
+	lock->Acquire();
+    hdr->FetchFrom(sector);
+    if (!held)
+	lock->Release();
+}
+
 //----------------------------------------------------------------------
 // FileSystem::Open
-// 	Open a file for reading and writing.  
+// 	Open a file for reading and writing.
 //	To open a file:
-//	  Find the location of the file's header, using the directory 
+//	  Find the location of the file's header, following its path
 //	  Bring the header into memory
 //
-//	"name" -- the text name of the file to be opened
+//	"name" -- the path of the file to be opened
 //----------------------------------------------------------------------
 
 OpenFile *
 FileSystem::Open(const char *name)
-{ 
-    Directory *directory = new Directory(NumDirEntries);
+{
     OpenFile *openFile = NULL;
+    bool isDirectory;
     int sector;
 
     DEBUG('f', "Opening file %s\n", name);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name); 
-    if (sector >= 0) 		
-	openFile = new OpenFile(sector);	// name was found in directory 
-    delete directory;
-    return openFile;				// return NULL if not found
+    lock->Acquire();
+    sector = Resolve(name, &isDirectory);
+    if (sector >= 0 && !isDirectory)
+	openFile = new OpenFile(sector);	// name was found
+    lock->Release();
+    return openFile;				// return NULL if not found,
+						// or if it is a directory
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Remove
 // 	Delete a file from the file system.  This requires:
-//	    Remove it from the directory
+//	    Remove it from the directory it is in
 //	    Delete the space for its header
 //	    Delete the space for its data blocks
-//	    Write changes to directory, bitmap back to disk
+//	    Mark the bitmap as changed
 //
 //	Return true if the file was deleted, false if the file wasn't
-//	in the file system.
+//	in the file system, or is a directory.
 //
-//	"name" -- the text name of the file to be removed
+//	"name" -- the path of the file to be removed
 //----------------------------------------------------------------------
 
 bool
 FileSystem::Remove(const char *name)
-{ 
-    Directory *directory;
-    BitMap *freeMap;
+{
+    return RemoveFile(name, false);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::RemoveDirectory
+// 	Delete an empty directory from the file system (similar to UNIX
+//	rmdir), the same way Remove deletes a file.  Return false if it
+//	is not a directory, or not empty, or the root.
+//
+//	"name" -- the path of the directory to be removed
+//----------------------------------------------------------------------
+
+bool
+FileSystem::RemoveDirectory(const char *name)
+{
+    return RemoveFile(name, true);
+}
+
+//----------------------------------------------------------------------
+// FileSystem::RemoveFile
+// 	Delete a file or a directory, as described for Remove.
+//----------------------------------------------------------------------
+
+bool
+FileSystem::RemoveFile(const char *path, bool isDirectory)
+{
+    char name[FileNameMaxLen + 1];
     FileHeader *fileHdr;
-    int sector;
-    
-    directory = new Directory(NumDirEntries);
-    directory->FetchFrom(directoryFile);
-    sector = directory->Find(name);
-    if (sector == -1) {
-       delete directory;
-       return false;			 // file not found 
+    Directory *dir;
+    int dirSector, sector = -1;
+    bool found;
+
+    lock->Acquire();
+    dirSector = ResolveParent(path, name);
+    if (dirSector != -1)
+	sector = LookupIn(dirSector, name, &found);
+    if (sector != -1 && found && isDirectory) {
+	dir = OpenDirectory(sector);
+	if (dir->NumEntries() > 0)
+	    sector = -1;		// directory not empty
+	CloseDirectory(dir);
+    }
+    if (sector == -1 || found != isDirectory) {
+       lock->Release();
+       return false;			 // not found, or not the kind asked for
     }
     fileHdr = new FileHeader;
     fileHdr->FetchFrom(sector);
 
-    freeMap = new BitMap(NumSectors);
-    freeMap->FetchFrom(freeMapFile);
-
     fileHdr->Deallocate(freeMap);  		// remove data blocks
     freeMap->Clear(sector);			// remove header block
-    directory->Remove(name);
+    dir = OpenDirectory(dirSector);
+    dir->Remove(name);
+    CloseDirectory(dir);
+    dentries->Forget(dirSector, name);
+    if (isDirectory)
+	dentries->Forget(sector, "..");
+    freeMapDirty = true;
+    lock->Release();
 
-    freeMap->WriteBack(freeMapFile);		// flush to disk
-    directory->WriteBack(directoryFile);        // flush to disk
     delete fileHdr;
-    delete directory;
-    delete freeMap;
     return true;
-} 
+}
 
 //----------------------------------------------------------------------
 // FileSystem::List
-// 	List all the files in the file system directory.
+// 	List all the files in the file system, directory by directory.
 //----------------------------------------------------------------------
 
 void
 FileSystem::List()
 {
-    Directory *directory = new Directory(NumDirEntries);
-
-    directory->FetchFrom(directoryFile);
-    directory->List();
-    delete directory;
+    lock->Acquire();
+    root->List("");
+    lock->Release();
 }
 
 //----------------------------------------------------------------------
 // FileSystem::Print
 // 	Print everything about the file system:
 //	  the contents of the bitmap
-//	  the contents of the directory
-//	  for each file in the directory,
+//	  the contents of the directories
+//	  for each file in the directories,
 //	      the contents of the file header
 //	      the data in the file
 //----------------------------------------------------------------------
@@ -317,9 +631,9 @@ FileSystem::Print()
 {
     FileHeader *bitHdr = new FileHeader;
     FileHeader *dirHdr = new FileHeader;
-    BitMap *freeMap = new BitMap(NumSectors);
-    Directory *directory = new Directory(NumDirEntries);
 
+    Sync();				// so the files show the latest changes
+    lock->Acquire();
     printf("Bit map file header:\n");
     bitHdr->FetchFrom(FreeMapSector);
     bitHdr->Print();
@@ -328,14 +642,32 @@ FileSystem::Print()
     dirHdr->FetchFrom(DirectorySector);
     dirHdr->Print();
 
-    freeMap->FetchFrom(freeMapFile);
     freeMap->Print();
-
-    directory->FetchFrom(directoryFile);
-    directory->Print();
+    root->Print("");
+    lock->Release();
 
     delete bitHdr;
     delete dirHdr;
-    delete freeMap;
-    delete directory;
-} 
+}
+
+//----------------------------------------------------------------------
+// FileSystem::PrintFragmentation
+// 	Report how fragmented the file system is: how many extents each
+//	file is in, and how many runs the free sectors are split into.
+//----------------------------------------------------------------------
+
+void
+FileSystem::PrintFragmentation()
+{
+    int numFiles = 0, numExtents = 0, runs, largest;
+
+    lock->Acquire();
+    root->PrintExtents("", &numFiles, &numExtents);
+    if (numFiles > 0)
+	printf("Files: %d, extents %d (%.2f per file)\n", numFiles,
+		numExtents, (double) numExtents / numFiles);
+    runs = freeMap->NumClearRuns(&largest);
+    printf("Free space: %d sectors in %d runs, largest %d sectors\n",
+	freeMap->NumClear(), runs, largest);
+    lock->Release();
+}
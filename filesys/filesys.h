@@ -20,13 +20,13 @@
 //	file system (in a file named "DISK"). 
 //
 //	In the "real" implementation, there are two key data structures used 
-//	in the file system.  There is a single "root" directory, listing
-//	all of the files in the file system; unlike UNIX, the baseline
-//	system does not provide a hierarchical directory structure.  
-//	In addition, there is a bitmap for allocating
-//	disk sectors.  Both the root directory and the bitmap are themselves
-//	stored as files in the Nachos file system -- this causes an interesting
-//	bootstrap problem when the simulated disk is initialized. 
+//	in the file system.  There is a "root" directory, listing files
+//	and the directories in it, which list more, as in UNIX; files are
+//	named by their path from the root.  In addition, there is a bitmap
+//	for allocating disk sectors.  Both the directories and the bitmap
+//	are themselves stored as files in the Nachos file system -- this
+//	causes an interesting bootstrap problem when the simulated disk is
+//	initialized. 
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -38,6 +38,11 @@
 #include "copyright.h"
 #include "openfile.h"
 
+class BitMap;
+class DentryCache;
+class Directory;
+class Lock;
+
 #ifdef FILESYS_STUB 		// Temporarily implement file system calls as 
 				// calls to UNIX, until the real file system
 				// implementation is available
@@ -73,6 +78,8 @@ class FileSystem {
     					// If "format", there is nothing on
 					// the disk, so initialize the directory
     					// and the bitmap of free blocks.
+    ~FileSystem();			// Write back any changes, and close
+					// the bitmap and directory files
 
     bool Create(const char *name, int initialSize);  	
 					// Create a file (UNIX creat)
@@ -81,15 +88,60 @@ class FileSystem {
 
     bool Remove(const char *name);  	// Delete a file (UNIX unlink)
 
+    bool MakeDirectory(const char *name);
+					// Create a directory (UNIX mkdir)
+
+    bool RemoveDirectory(const char *name);
+					// Delete an empty directory
+					// (UNIX rmdir)
+
     void List();			// List all the files in the file system
 
     void Print();			// List all the files and their contents
 
+    void PrintFragmentation();		// Report how many pieces the files
+					// and the free space are in
+
+    void Sync();			// Write the bitmap and the directory
+					// back to disk, if they changed
+
+    bool Extend(int sector, FileHeader *hdr, int numBytes, bool grow);
+					// Allocate space for the file whose
+					// header is at "sector" to hold
+					// "numBytes" bytes, and if "grow",
+					// make it that long
+    void Reload(int sector, FileHeader *hdr);
+					// Read the header of an open file
+					// again, in case it grew
+
   private:
    OpenFile* freeMapFile;		// Bit map of free disk blocks,
 					// represented as a file
-   OpenFile* directoryFile;		// "Root" directory -- list of 
+   Directory* root;			// "Root" directory -- list of 
 					// file names, represented as a file
+
+   BitMap* freeMap;			// In-memory copy of the bitmap
+   bool freeMapDirty;			// Changed since written to disk?
+   DentryCache* dentries;		// Names looked up recently
+   Lock* lock;				// Protects all of the above
+
+   Directory* OpenDirectory(int sector);
+   void CloseDirectory(Directory *dir);
+					// Open the directory whose header
+					// is at "sector", and close it
+
+   int LookupIn(int dirSector, const char *name, bool *isDirectory);
+					// Look up "name" in a directory
+   int Resolve(const char *path, bool *isDirectory);
+					// Look up "path" from the root
+   int ResolveParent(const char *path, char *name);
+					// Find the directory "path" is in,
+					// and its last name
+
+   bool AddFile(const char *path, int initialSize, bool isDirectory);
+   bool RemoveFile(const char *path, bool isDirectory);
+					// Create or delete a file or a
+					// directory
 };
 
 #endif // FILESYS
@@ -28,7 +28,11 @@ OpenFile::OpenFile(int sector)
 { 
     hdr = new FileHeader;
     hdr->FetchFrom(sector);
+    hdrSector = sector;
     seekPosition = 0;
+    lastRead = -1;
+    readAheadWindow = 0;
+    readAheadNext = 0;
 }
 
 //----------------------------------------------------------------------
@@ -92,16 +96,22 @@ OpenFile::Write(const char *into, int numBytes)
 //
 //	There is no guarantee the request starts or ends on an even disk sector
 //	boundary; however the disk only knows how to read/write a whole disk
-//	sector at a time.  Thus:
+//	sector at a time.  Thus each sector of the request is held in the
+//	buffer cache while we copy the part we are interested in:
 //
 //	For ReadAt:
-//	   We read in all of the full or partial sectors that are part of the
-//	   request, but we only copy the part we are interested in.
+//	   The cache reads in the sector, unless it has it already.
+//	   When reads go through the file in order, the sectors after
+//	   them are read ahead, so they are usually there.
 //	For WriteAt:
-//	   We must first read in any sectors that will be partially written,
-//	   so that we don't overwrite the unmodified portion.  We then copy
-//	   in the data that will be modified, and write back all the full
-//	   or partial sectors that are part of the request.
+//	   Sectors that are partially written must be read in first, so
+//	   that we don't overwrite the unmodified portion.  Sectors that
+//	   are written in full are not.  The cache writes them back.
+//	   Writing at or past the end of the file makes it grow; if the
+//	   disk is full, only the part that fits in the file is written.
+//
+//	Another open file may have made the file grow, so a read past
+//	the end reads the file header again first.
 //
 //	"into" -- the buffer to contain the data to be read from disk 
 //	"from" -- the buffer containing the data to be written to disk 
@@ -114,9 +124,12 @@ int
 OpenFile::ReadAt(char *into, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    char *buf;
+    int i, firstSector, lastSector;
 
+    if (numBytes > 0 && position + numBytes > fileLength) {
+	fileSystem->Reload(hdrSector, hdr);
+	fileLength = hdr->FileLength();
+    }
     if ((numBytes <= 0) || (position >= fileLength))
     	return 0; 				// check request
     if ((position + numBytes) > fileLength)		
@@ -126,17 +139,18 @@ OpenFile::ReadAt(char *into, int numBytes, int position)
 
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
-
-    // read in all the full and partial sectors that we need
-    buf = new char[numSectors * SectorSize];
-    for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->ReadSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
+    ReadAhead(firstSector, lastSector);
 
-    // copy the part we want
-    bcopy(&buf[position - (firstSector * SectorSize)], into, numBytes);
-    delete [] buf;
+    // copy the part we want out of each sector
+    for (i = firstSector; i <= lastSector; i++) {
+	int sector = hdr->ByteToSector(i * SectorSize);
+	int start = (i == firstSector) ? position : i * SectorSize;
+	int end = (i == lastSector) ? position + numBytes : (i + 1) * SectorSize;
+	char *data = bufferCache->Pin(sector);
+	bcopy(&data[start - i * SectorSize], &into[start - position],
+	    end - start);
+	bufferCache->Unpin(sector, false);
+    }
     return numBytes;
 }
 
@@ -144,42 +158,101 @@ int
 OpenFile::WriteAt(const char *from, int numBytes, int position)
 {
     int fileLength = hdr->FileLength();
-    int i, firstSector, lastSector, numSectors;
-    bool firstAligned, lastAligned;
-    char *buf;
+    int oldLength = fileLength;
+    int i, firstSector, lastSector;
 
-    if ((numBytes <= 0) || (position >= fileLength))
+    if ((numBytes <= 0) || (position > fileLength))
 	return 0;				// check request
-    if ((position + numBytes) > fileLength)
-	numBytes = fileLength - position;
+    if ((position + numBytes) > fileLength) {
+	if (fileSystem->Extend(hdrSector, hdr, position + numBytes, true))
+	    fileLength = hdr->FileLength();
+	else if (position == fileLength)
+	    return 0;				// disk full
+	else
+	    numBytes = fileLength - position;
+    }
     DEBUG('f', "Writing %d bytes at %d, from file of length %d.\n", 	
 			numBytes, position, fileLength);
 
     firstSector = divRoundDown(position, SectorSize);
     lastSector = divRoundDown(position + numBytes - 1, SectorSize);
-    numSectors = 1 + lastSector - firstSector;
 
-    buf = new char[numSectors * SectorSize];
+    // copy in the bytes we want to change, reading in the sectors that
+    // are only partially modified.  Bytes past the old end of the file
+    // hold nothing worth reading: they are zeroed instead.
+    for (i = firstSector; i <= lastSector; i++) {
+	int sector = hdr->ByteToSector(i * SectorSize);
+	int sectorStart = i * SectorSize, sectorEnd = (i + 1) * SectorSize;
+	int start = (i == firstSector) ? position : sectorStart;
+	int end = (i == lastSector) ? position + numBytes : sectorEnd;
+	bool overwrite = sectorStart >= oldLength
+	    || (start == sectorStart && (end == sectorEnd || end >= oldLength));
+	char *data = bufferCache->Pin(sector, overwrite);
+	if (overwrite) {
+	    bzero(data, start - sectorStart);
+	    bzero(&data[end - sectorStart], sectorEnd - end);
+	}
+	bcopy(&from[start - position], &data[start - sectorStart],
+	    end - start);
+	bufferCache->Unpin(sector, true);
+    }
+    return numBytes;
+}
+
+//----------------------------------------------------------------------
+// OpenFile::ReadAhead
+// 	Keep the buffer cache ahead of a reader going through the file in
+//	order.  A read that starts in the sector where the last one ended,
+//	or in the next, is sequential, and doubles the number of sectors
+//	read ahead, up to MaxReadAhead; any other read stops read-ahead
+//	until the reader goes in order again.  Only sectors not asked for
+//	before are asked for, so each read asks for a few at most.
+//
+//	"firstSector", "lastSector" -- the sectors of the file being read
+//----------------------------------------------------------------------
+
+void
+OpenFile::ReadAhead(int firstSector, int lastSector)
+{
+    int numSectors = divRoundUp(hdr->FileLength(), SectorSize);
+    int i, last;
 
-    firstAligned = (position == (firstSector * SectorSize));
-    lastAligned = ((position + numBytes) == ((lastSector + 1) * SectorSize));
+    if (firstSector == lastRead || firstSector == lastRead + 1) {
+	if (lastSector == lastRead)
+	    return;				// still in the same sector
+	if (readAheadWindow == 0)
+	    readAheadWindow = 1;
+	else if (readAheadWindow < MaxReadAhead)
+	    readAheadWindow *= 2;
+    } else {
+	readAheadWindow = 0;
+	readAheadNext = 0;
+    }
+    lastRead = lastSector;
 
-// read in first and last sector, if they are to be partially modified
-    if (!firstAligned)
-        ReadAt(buf, SectorSize, firstSector * SectorSize);	
-    if (!lastAligned && ((firstSector != lastSector) || firstAligned))
-        ReadAt(&buf[(lastSector - firstSector) * SectorSize], 
-				SectorSize, lastSector * SectorSize);	
+    i = (readAheadNext > lastSector) ? readAheadNext : lastSector + 1;
+    last = lastSector + readAheadWindow;
+    if (last >= numSectors)
+	last = numSectors - 1;
+    for (; i <= last; i++) {
+	DEBUG('f', "Reading sector %d of the file ahead, window %d.\n",
+		i, readAheadWindow);
+	bufferCache->ReadAhead(hdr->ByteToSector(i * SectorSize));
+	readAheadNext = i + 1;
+    }
+}
 
-// copy in the bytes we want to change 
-    bcopy(from, &buf[position - (firstSector * SectorSize)], numBytes);
+//----------------------------------------------------------------------
+// OpenFile::Reserve
+// 	Allocate the space for the file to grow to "numBytes" bytes, so
+//	that writing it later does not need to.  The length of the file
+//	does not change.  Return false if there is not enough space.
+//----------------------------------------------------------------------
 
-// write modified sectors back
-    for (i = firstSector; i <= lastSector; i++)	
-        synchDisk->WriteSector(hdr->ByteToSector(i * SectorSize), 
-					&buf[(i - firstSector) * SectorSize]);
-    delete [] buf;
-    return numBytes;
+bool
+OpenFile::Reserve(int numBytes)
+{
+    return fileSystem->Extend(hdrSector, hdr, numBytes, false);
 }
 
 //----------------------------------------------------------------------
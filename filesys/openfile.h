@@ -52,6 +52,10 @@ class OpenFile {
 		}
 
     int Length() { Lseek(file, 0, 2); return Tell(file); }
+
+    bool Reserve(int numBytes) { return true; }
+					// UNIX allocates space as the file
+					// grows; a reservation is a hint
     
   private:
     int file;
@@ -61,6 +65,9 @@ class OpenFile {
 #else // FILESYS
 class FileHeader;
 
+#define MaxReadAhead 8			// Most sectors read ahead of a
+					// sequential reader
+
 class OpenFile {
   public:
     OpenFile(int sector);		// Open a file whose header is located
@@ -86,10 +93,22 @@ class OpenFile {
 					// file (this interface is simpler 
 					// than the UNIX idiom -- lseek to 
 					// end of file, tell, lseek back 
+
+    bool Reserve(int numBytes);		// Allocate space for the file to
+					// grow to "numBytes" bytes
     
   private:
     FileHeader *hdr;			// Header for this file 
+    int hdrSector;			// Where the header is on disk
     int seekPosition;			// Current position within the file
+
+    void ReadAhead(int firstSector, int lastSector);
+					// Note a read of these sectors of
+					// the file, and ask for the ones
+					// after them if it is sequential
+    int lastRead;			// Last sector of the file read
+    int readAheadWindow;		// Sectors to keep read ahead of it
+    int readAheadNext;			// First sector not asked for yet
 };
 
 #endif // FILESYS
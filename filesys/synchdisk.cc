@@ -5,10 +5,12 @@
 //	the disk providing a synchronous interface (requests wait until
 //	the request completes).
 //
-//	Use a semaphore to synchronize the interrupt handlers with the
-//	pending requests.  And, because the physical disk can only
-//	handle one operation at a time, use a lock to enforce mutual
-//	exclusion.
+//	Because the physical disk can only handle one operation at a
+//	time, requests wait in a queue, sorted by sector, and each disk
+//	interrupt sends the next one in elevator order.  Each request has
+//	a semaphore to synchronize the interrupt handler with the thread
+//	waiting for it.  The queue is shared with the interrupt handler,
+//	so it is protected by disabling interrupts.
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
@@ -16,6 +18,7 @@
 
 #include "copyright.h"
 #include "synchdisk.h"
+#include "system.h"
 
 //----------------------------------------------------------------------
 // DiskRequestDone
@@ -31,6 +34,29 @@ DiskRequestDone (void* arg)
     disk->RequestDone();
 }
 
+//----------------------------------------------------------------------
+// DiskRequest::DiskRequest
+// 	Set up a request to read or write "count" sectors from
+//	"sectorNumber" on, from or into "buffers".
+//----------------------------------------------------------------------
+
+DiskRequest::DiskRequest(int sectorNumber, int count, char** buffers,
+			 bool isWrite)
+{
+    sector = sectorNumber;
+    numSectors = count;
+    data = buffers;
+    writing = isWrite;
+    queuedAt = startedAt = 0;
+    done = new Semaphore("disk request", 0);
+    next = NULL;
+}
+
+DiskRequest::~DiskRequest()
+{
+    delete done;
+}
+
 //----------------------------------------------------------------------
 // SynchDisk::SynchDisk
 // 	Initialize the synchronous interface to the physical disk, in turn
@@ -42,8 +68,9 @@ DiskRequestDone (void* arg)
 
 SynchDisk::SynchDisk(const char* name)
 {
-    semaphore = new Semaphore("synch disk", 0);
-    lock = new Lock("synch disk lock");
+    queue = current = NULL;
+    transfer = new char *[NumSectors];
+    headSector = 0;
     disk = new Disk(name, DiskRequestDone, this);
 }
 
@@ -55,9 +82,9 @@ SynchDisk::SynchDisk(const char* name)
 
 SynchDisk::~SynchDisk()
 {
+    ASSERT(queue == NULL && current == NULL);
     delete disk;
-    delete lock;
-    delete semaphore;
+    delete [] transfer;
 }
 
 //----------------------------------------------------------------------
@@ -72,10 +99,9 @@ SynchDisk::~SynchDisk()
 void
 SynchDisk::ReadSector(int sectorNumber, char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->ReadRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    DiskRequest request(sectorNumber, 1, &data, false);
+
+    Serve(&request);
 }
 
 //----------------------------------------------------------------------
@@ -90,20 +116,135 @@ SynchDisk::ReadSector(int sectorNumber, char* data)
 void
 SynchDisk::WriteSector(int sectorNumber, const char* data)
 {
-    lock->Acquire();			// only one disk I/O at a time
-    disk->WriteRequest(sectorNumber, data);
-    semaphore->P();			// wait for interrupt
-    lock->Release();
+    char *buffer = (char *) data;
+    DiskRequest request(sectorNumber, 1, &buffer, true);
+
+    Serve(&request);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::ReadSectors/WriteSectors
+// 	Read/write "numSectors" consecutive sectors, each into/from its
+//	own buffer, in a single request.  Return only after the data has
+//	been read/written.
+//
+//	"sectorNumber" -- the first disk sector to read/write
+//	"numSectors" -- how many sectors to read/write
+//	"data" -- the buffer of each sector
+//----------------------------------------------------------------------
+
+void
+SynchDisk::ReadSectors(int sectorNumber, int numSectors, char** data)
+{
+    DiskRequest request(sectorNumber, numSectors, data, false);
+
+    Serve(&request);
+}
+
+void
+SynchDisk::WriteSectors(int sectorNumber, int numSectors, char** data)
+{
+    DiskRequest request(sectorNumber, numSectors, data, true);
+
+    Serve(&request);
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::Serve
+// 	Put a request in the queue, sorted by sector, after any others for
+//	the same sector so that they are done in the order they were made.
+//	Start it right away if the disk is idle, and wait until it is done.
+//
+//	"request" -- the request to serve
+//----------------------------------------------------------------------
+
+void
+SynchDisk::Serve(DiskRequest *request)
+{
+    IntStatus oldLevel = interrupt->SetLevel(IntOff);
+    DiskRequest **link = &queue;
+
+    request->queuedAt = stats->totalTicks;
+    while (*link != NULL && (*link)->sector <= request->sector)
+	link = &(*link)->next;
+    request->next = *link;
+    *link = request;
+    if (current == NULL)
+	StartNext();
+    (void) interrupt->SetLevel(oldLevel);
+
+    request->done->P();			// wait for interrupt
+}
+
+//----------------------------------------------------------------------
+// SynchDisk::StartNext
+// 	Send the disk the first request at or past the last one sent, or
+//	the first one of all if there is none, so that the head keeps
+//	moving the same way, and only goes back once at the end of each
+//	sweep.  The requests that follow it in the queue go along in the
+//	same transfer, as long as they are of the same kind, start where
+//	the transfer ends, and fit in MaxTransfer sectors.  Interrupts
+//	must be disabled, and the queue not empty.
+//----------------------------------------------------------------------
+
+void
+SynchDisk::StartNext()
+{
+    DiskRequest **link = &queue;
+    DiskRequest *last;
+    int count, i;
+
+    while (*link != NULL && (*link)->sector < headSector)
+	link = &(*link)->next;
+    if (*link == NULL)
+	link = &queue;			// end of the sweep, go back
+    current = last = *link;
+    *link = current->next;
+    count = current->numSectors;
+    while (*link != NULL && (*link)->writing == current->writing
+		&& (*link)->sector == current->sector + count
+		&& count + (*link)->numSectors <= MaxTransfer) {
+	last->next = *link;
+	last = *link;
+	*link = last->next;
+	count += last->numSectors;
+    }
+    last->next = NULL;
+
+    DEBUG('f', "Disk request for %d sectors at %d, head at track %d.\n",
+	count, current->sector, headSector / SectorsPerTrack);
+    count = 0;
+    for (DiskRequest *request = current; request != NULL;
+		request = request->next) {
+	for (i = 0; i < request->numSectors; i++)
+	    transfer[count++] = request->data[i];
+	request->startedAt = stats->totalTicks;
+    }
+    headSector = current->sector + count - 1;
+    if (current->writing)
+	disk->WriteRequest(current->sector, count, transfer);
+    else
+	disk->ReadRequest(current->sector, count, transfer);
 }
 
 //----------------------------------------------------------------------
 // SynchDisk::RequestDone
-// 	Disk interrupt handler.  Wake up any thread waiting for the disk
-//	request to finish.
+// 	Disk interrupt handler.  Wake up the threads waiting for the disk
+//	requests to finish, and start the next ones.
 //----------------------------------------------------------------------
 
 void
 SynchDisk::RequestDone()
 { 
-    semaphore->V();
+    for (DiskRequest *request = current; request != NULL;
+		request = request->next) {
+	stats->numDiskRequests++;
+	stats->diskQueueTicks += request->startedAt - request->queuedAt;
+	stats->diskServiceTicks += stats->totalTicks - request->startedAt;
+	request->done->V();		// its thread does not run, and free
+					// it, until we are done
+    }
+    current = NULL;
+    if (queue != NULL)
+	StartNext();
 }
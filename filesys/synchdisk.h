@@ -24,6 +24,35 @@
 // This class provides the abstraction that for any individual thread
 // making a request, it waits around until the operation finishes before
 // returning.
+//
+// Requests from different threads wait in a queue while the disk is
+// busy, and are sent to it in elevator (C-LOOK) order: the head sweeps
+// towards higher sectors, taking requests as it reaches them, and then
+// jumps back to the lowest one waiting.  Since sectors are numbered
+// track by track, this takes each track's requests in a row, in the
+// order they come under the head.  Requests of the same kind for
+// adjacent sectors are merged, and sent to the disk as one transfer of
+// up to MaxTransfer sectors.
+
+#define MaxTransfer	SectorsPerTrack	// Most sectors merged into a transfer
+
+// A request waiting for the disk, or being served by it.
+class DiskRequest {
+  public:
+    DiskRequest(int sectorNumber, int count, char** buffers, bool isWrite);
+    ~DiskRequest();
+
+    int sector;				// First sector to read or write
+    int numSectors;			// How many
+    char** data;			// Where the contents of each go or
+					// come from
+    bool writing;			// A write, rather than a read
+    int queuedAt;			// When it was made
+    int startedAt;			// When it was sent to the disk
+    Semaphore *done;			// The requesting thread waits here
+    DiskRequest *next;			// Next in sector order
+};
+
 class SynchDisk {
   public:
     SynchDisk(const char* name);    	// Initialize a synchronous disk,
@@ -37,17 +66,31 @@ class SynchDisk {
     					// Disk::ReadRequest/WriteRequest and
 					// then wait until the request is done.
     void WriteSector(int sectorNumber, const char* data);
+
+    void ReadSectors(int sectorNumber, int numSectors, char** data);
+    void WriteSectors(int sectorNumber, int numSectors, char** data);
+					// The same, for "numSectors" sectors
+					// from "sectorNumber" on, each with
+					// its own buffer
     
     void RequestDone();			// Called by the disk device interrupt
 					// handler, to signal that the
-					// current disk operation is complete.
+					// current disk operation is complete,
+					// and to start the next one.
 
   private:
+    void Serve(DiskRequest *request);	// Queue a request, and wait until
+					// it is done
+    void StartNext();			// Send the next request in elevator
+					// order to the disk
+
     Disk *disk;		  		// Raw disk device
-    Semaphore *semaphore; 		// To synchronize requesting thread 
-					// with the interrupt handler
-    Lock *lock;		  		// Only one read/write request
-					// can be sent to the disk at a time
+    DiskRequest *queue;			// Requests waiting for the disk,
+					// sorted by sector
+    DiskRequest *current;		// The ones being served, merged into
+					// one transfer, or NULL
+    char **transfer;			// Buffers of the transfer
+    int headSector;			// Where the last request sent was
 };
 
 #endif // SYNCHDISK_H
@@ -115,40 +115,75 @@ PrintSector (bool writing, int sector, const char *data)
 void
 Disk::ReadRequest(int sectorNumber, char* data)
 {
-    int ticks = ComputeLatency(sectorNumber, false);
+    ReadRequest(sectorNumber, 1, &data);
+}
+
+void
+Disk::WriteRequest(int sectorNumber, const char* data)
+{
+    char *buffer = (char *) data;
+
+    WriteRequest(sectorNumber, 1, &buffer);
+}
+
+//----------------------------------------------------------------------
+// Disk::ReadRequest/WriteRequest
+// 	Simulate a request to read/write a run of consecutive disk
+//	sectors, scattering them into/gathering them from one buffer
+//	each.  As above, the UNIX file is read/written right away, with
+//	a single system call, and one interrupt is scheduled for when
+//	the last sector has been transferred.
+//
+//	"sectorNumber" -- the first disk sector to read/write
+//	"numSectors" -- how many sectors to read/write
+//	"data" -- the buffer of each sector
+//----------------------------------------------------------------------
+
+void
+Disk::ReadRequest(int sectorNumber, int numSectors, char** data)
+{
+    int ticks = ComputeLatency(sectorNumber, numSectors, false);
 
     ASSERT(!active);				// only one request at a time
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (numSectors > 0)
+		&& (sectorNumber + numSectors <= NumSectors));
     
-    DEBUG('d', "Reading from sector %d\n", sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    Read(fileno, data, SectorSize);
+    DEBUG('d', "Reading %d sectors from sector %d\n", numSectors,
+		sectorNumber);
+    ReadVector(fileno, data, numSectors, SectorSize,
+		SectorSize * sectorNumber + MagicSize);
     if (DebugIsEnabled('d'))
-	PrintSector(false, sectorNumber, data);
+	for (int i = 0; i < numSectors; i++)
+	    PrintSector(false, sectorNumber + i, data[i]);
     
     active = true;
-    UpdateLast(sectorNumber);
+    UpdateLast(sectorNumber, numSectors, ticks);
     stats->numDiskReads++;
+    stats->numDiskSectorsRead += numSectors;
     interrupt->Schedule(DiskDone, this, ticks, DiskInt);
 }
 
 void
-Disk::WriteRequest(int sectorNumber, const char* data)
+Disk::WriteRequest(int sectorNumber, int numSectors, char** data)
 {
-    int ticks = ComputeLatency(sectorNumber, true);
+    int ticks = ComputeLatency(sectorNumber, numSectors, true);
 
     ASSERT(!active);
-    ASSERT((sectorNumber >= 0) && (sectorNumber < NumSectors));
+    ASSERT((sectorNumber >= 0) && (numSectors > 0)
+		&& (sectorNumber + numSectors <= NumSectors));
     
-    DEBUG('d', "Writing to sector %d\n", sectorNumber);
-    Lseek(fileno, SectorSize * sectorNumber + MagicSize, 0);
-    WriteFile(fileno, data, SectorSize);
+    DEBUG('d', "Writing %d sectors to sector %d\n", numSectors,
+		sectorNumber);
+    WriteVector(fileno, data, numSectors, SectorSize,
+		SectorSize * sectorNumber + MagicSize);
     if (DebugIsEnabled('d'))
-	PrintSector(true, sectorNumber, data);
+	for (int i = 0; i < numSectors; i++)
+	    PrintSector(true, sectorNumber + i, data[i]);
     
     active = true;
-    UpdateLast(sectorNumber);
+    UpdateLast(sectorNumber, numSectors, ticks);
     stats->numDiskWrites++;
+    stats->numDiskSectorsWritten += numSectors;
     interrupt->Schedule(DiskDone, this, ticks, DiskInt);
 }
 
@@ -252,12 +287,47 @@ Disk::ComputeLatency(int newSector, bool writing)
     return(seek + rotation + RotationTime);
 }
 
+//----------------------------------------------------------------------
+// Disk::ComputeLatency()
+// 	Return how long will it take to read/write "numSectors" sectors
+//	starting at "newSector": the latency of the first one, plus one
+//	RotationTime for each of the others, plus SeekTime for each
+//	track boundary the run crosses (the tracks are assumed to be
+//	skewed so that the next sector is under the head after the seek).
+//----------------------------------------------------------------------
+
+int
+Disk::ComputeLatency(int newSector, int numSectors, bool writing)
+{
+    int lastNew = newSector + numSectors - 1;
+    int crossings = lastNew / SectorsPerTrack - newSector / SectorsPerTrack;
+
+    return ComputeLatency(newSector, writing)
+		+ (numSectors - 1) * RotationTime + crossings * SeekTime;
+}
+
 //----------------------------------------------------------------------
 // Disk::UpdateLast
 //   	Keep track of the most recently requested sector.  So we can know
-//	what is in the track buffer.
+//	what is in the track buffer.  For a run of "numSectors" sectors
+//	taking "ticks", it is the last sector of the run that counts.
 //----------------------------------------------------------------------
 
+void
+Disk::UpdateLast(int newSector, int numSectors, int ticks)
+{
+    int lastNew = newSector + numSectors - 1;
+    int onLastTrack = lastNew % SectorsPerTrack + 1;
+
+    UpdateLast(newSector);
+    if (lastNew / SectorsPerTrack != newSector / SectorsPerTrack) {
+	// the run went on to another track; the track buffer has been
+	// filling since the head got there
+	bufferInit = stats->totalTicks + ticks - onLastTrack * RotationTime;
+    }
+    lastSector = lastNew;
+}
+
 void
 Disk::UpdateLast(int newSector)
 {
@@ -45,6 +45,11 @@
 // disks these days now come with a track buffer.
 //
 // The track buffer simulation can be disabled by compiling with -DNOTRACKBUF
+//
+// A request may also cover several consecutive sectors, each with its
+// own buffer (scatter/gather).  It pays for getting to the first sector
+// once; the rest follow at one sector per RotationTime, plus a one-track
+// seek each time the run goes on to the next track.
 
 const int SectorSize = 128;	// number of bytes per disk sector
 const int SectorsPerTrack = 32;	// number of sectors per disk track 
@@ -67,6 +72,13 @@ class Disk {
     					// Only one request allowed at a time!
     void WriteRequest(int sectorNumber, const char* data);
 
+    void ReadRequest(int sectorNumber, int numSectors, char** data);
+    					// Read/write "numSectors" sectors,
+					// starting at "sectorNumber", into/
+					// from one buffer each, as a single
+					// request.
+    void WriteRequest(int sectorNumber, int numSectors, char** data);
+
     void HandleInterrupt();		// Interrupt handler, invoked when
 					// disk request finishes.
 
@@ -74,6 +86,8 @@ class Disk {
     					// Return how long a request to 
 					// newSector will take: 
 					// (seek + rotational delay + transfer)
+    int ComputeLatency(int newSector, int numSectors, bool writing);
+					// The same, for a run of sectors
 
   private:
     int fileno;				// UNIX file number for simulated disk 
@@ -88,6 +102,7 @@ class Disk {
     int TimeToSeek(int newSector, int *rotate); // time to get to the new track
     int ModuloDiff(int to, int from);        // # sectors between to and from
     void UpdateLast(int newSector);
+    void UpdateLast(int newSector, int numSectors, int ticks);
 };
 
 #endif // DISK_H
@@ -13,6 +13,10 @@
 
 // Textual names of the exceptions that can be generated by user program
 // execution, for debugging.
+int PageSize = SectorSize;
+int NumPhysPages = 32;
+int TLBSize = 16;
+
 static const char* exceptionNames[] = { "no exception", "syscall",
                     "page fault/no TLB entry", "page read only",
                     "bus error", "address error", "overflow",
@@ -67,6 +71,7 @@ Machine::Machine(bool debug) {
         tlb[i].valid = false;
     }
     pageTable = NULL;
+    asid = 0;
 #else  // use linear page table
     tlb = NULL;
     pageTable = NULL;
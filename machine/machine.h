@@ -44,15 +44,16 @@
 #endif
 #endif
 
-// Definitions related to the size, and format of user memory
+// Definitions related to the size, and format of user memory.  These
+// can be changed when Nachos starts (see Initialize), before the
+// machine is created.
 
-const int PageSize = SectorSize;    // set the page size equal to
-                                    // the disk sector size, for
-                                    // simplicity
+extern int PageSize;    // by default, the page size is equal to
+                        // the disk sector size, for simplicity
 
-const int NumPhysPages = 32;
-const int MemorySize = NumPhysPages * PageSize;
-const int TLBSize = 16;  // if there is a TLB, make it small
+extern int NumPhysPages;  // 32 by default
+#define MemorySize (NumPhysPages * PageSize)
+extern int TLBSize;  // if there is a TLB, make it small: 16 by default
 
 enum ExceptionType {
     NoException,            // Everything ok!
@@ -199,6 +200,10 @@ class Machine {
     TranslationEntry *pageTable;
     unsigned int pageTableSize;
 
+    int asid;  // Address space identifier of the running program;
+               // TLB entries tagged with any other one are ignored,
+               // so they need not be flushed on a context switch
+
  private:
     bool singleStep;  // drop back into the debugger after each
                 // simulated instruction
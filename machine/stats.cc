@@ -19,10 +19,20 @@
 Statistics::Statistics() {
     totalTicks = idleTicks = systemTicks = userTicks = 0;
     numDiskReads = numDiskWrites = 0;
+    numDiskSectorsRead = numDiskSectorsWritten = 0;
+    numDiskRequests = diskQueueTicks = diskServiceTicks = 0;
     numConsoleCharsRead = numConsoleCharsWritten = 0;
     numPageFaults = numPacketsSent = numPacketsRecvd = 0;
+    numZeroFillFaults = numLoadFaults = numSharedFaults = numSwapFaults = 0;
+    numCopyOnWriteFaults = numPrefetches = numPrefetchHits = 0;
+    numSwapWrites = numCleanEvictions = numPageoutEvictions = 0;
+    maxWorkingSet = maxTotalWorkingSet = numSuspensions = 0;
+    numCacheHits = numCacheMisses = numCacheWriteBacks = 0;
+    numReadAheads = numReadAheadHits = 0;
+    numNameLookups = numDentryHits = 0;
     numTlbLookups = 0;
     numTlbHits = 0;
+    numContextSwitches = 0;
 #ifdef DFS_TICKS_FIX
     numBugFix = 0;
 #endif
@@ -42,16 +52,50 @@ Statistics::Print() {
 #endif
     printf("Ticks: total %d, idle %d, system %d, user %d\n", totalTicks,
     idleTicks, systemTicks, userTicks);
-    printf("Disk I/O: reads %d, writes %d\n", numDiskReads, numDiskWrites);
+    printf("Disk I/O: reads %d, writes %d (sectors read %d, written %d)\n",
+    numDiskReads, numDiskWrites, numDiskSectorsRead, numDiskSectorsWritten);
+    if (numDiskRequests > 0) {
+        printf("Disk queue: requests %d, average wait %.1f ticks, average "
+        "service %.1f ticks\n", numDiskRequests,
+        diskQueueTicks * 1.0 / numDiskRequests,
+        diskServiceTicks * 1.0 / numDiskRequests);
+    }
+    if (numCacheHits + numCacheMisses > 0) {
+        printf("Buffer cache: hits %d, misses %d, hit ratio %f, sectors "
+        "written back %d\n", numCacheHits, numCacheMisses,
+        numCacheHits * 1.0 / (numCacheHits + numCacheMisses),
+        numCacheWriteBacks);
+        printf("Read-ahead: sectors read ahead %d, used %d\n", numReadAheads,
+        numReadAheadHits);
+    }
+    if (numNameLookups > 0) {
+        printf("Name lookups: %d, found in the dentry cache %d\n",
+        numNameLookups, numDentryHits);
+    }
     printf("Console I/O: reads %d, writes %d\n", numConsoleCharsRead,
     numConsoleCharsWritten);
-    printf("Paging: faults %d\n", numPageFaults);
+    printf("Paging: faults %d (zero-fill %d, loaded %d, shared %d, "
+    "swapped in %d), copy-on-write %d\n", numPageFaults, numZeroFillFaults,
+    numLoadFaults, numSharedFaults, numSwapFaults, numCopyOnWriteFaults);
+    printf("Prefetch: pages loaded ahead %d, used %d\n", numPrefetches,
+    numPrefetchHits);
+    printf("Swap: pages written %d, clean pages dropped %d, evicted by the "
+    "pageout daemon %d\n", numSwapWrites, numCleanEvictions,
+    numPageoutEvictions);
+    printf("Working sets: largest %d pages, largest sum %d pages, processes "
+    "suspended %d times\n", maxWorkingSet, maxTotalWorkingSet,
+    numSuspensions);
     printf("Network I/O: packets received %d, sent %d\n", numPacketsRecvd,
     numPacketsSent);
 
     if (numTlbLookups > 0) {
         printf("TLB: lookups %d, hits %d, hit ratio %f\n",
         numTlbLookups, numTlbHits, numTlbHits*1.0/numTlbLookups);
+        if (numContextSwitches > 0) {
+            printf("TLB: context switches %d, misses per switch %f\n",
+            numContextSwitches,
+            (numTlbLookups - numTlbHits) * 1.0 / numContextSwitches);
+        }
     } else {
         printf("TLB: lookups %d\n", numTlbLookups);
     }
@@ -30,13 +30,44 @@ class Statistics {
 
     int numDiskReads;  // Number of disk read requests
     int numDiskWrites;  // Number of disk write requests
+    int numDiskSectorsRead;  // Number of sectors they read
+    int numDiskSectorsWritten;  // Number of sectors they wrote
+    int numDiskRequests;  // Number of requests the disk queue served
+    int diskQueueTicks;  // Ticks they waited in the queue, in all
+    int diskServiceTicks;  // Ticks the disk took to serve them, in all
+    int numCacheHits;  // Number of sectors found in the buffer cache
+    int numCacheMisses;  // Number of sectors not found there
+    int numCacheWriteBacks;  // Number of dirty sectors it wrote back
+    int numReadAheads;  // Number of sectors it read ahead of time
+    int numReadAheadHits;  // Number of those used before being evicted
+    int numNameLookups;  // Number of names looked up in directories
+    int numDentryHits;  // Number of those found in the dentry cache
     int numConsoleCharsRead;  // Number of characters read from the keyboard
     int numConsoleCharsWritten;  // Number of characters written to the display
-    int numPageFaults;  // Number of virtual memory page faults
+    int numPageFaults;  // Number of virtual memory page faults, of which:
+    int numZeroFillFaults;  // pages of zeros (uninitialized data, stack)
+    int numLoadFaults;  // pages copied from the program's code and data
+    int numSharedFaults;  // code pages already loaded by another process
+    int numSwapFaults;  // pages read back from swap
+    int numCopyOnWriteFaults;  // Number of writes to copy-on-write pages
+    int numPrefetches;  // Number of pages loaded ahead of a fault
+    int numPrefetchHits;  // Number of those used before being evicted
+    int numSwapWrites;  // Number of evicted pages written to swap
+    int numCleanEvictions;  // Number of evicted pages not written, since
+                            // swap or the program already had them
+    int numPageoutEvictions;  // Number of pages evicted by the pageout
+                              // daemon rather than by a page fault
+    int maxWorkingSet;  // Largest working set of a process, in pages
+    int maxTotalWorkingSet;  // Largest sum of the working sets of the
+                             // processes in memory at the same time
+    int numSuspensions;  // Number of times a process was suspended
+                         // because the working sets did not fit
     int numPacketsSent;  // Number of packets sent over the network
     int numPacketsRecvd;  // Number of packets received over the network
     int numTlbLookups;  // Number of TLB lookups
     int numTlbHits;  // Number of TLB hits
+    int numContextSwitches;  // Number of times a user program was
+                             // switched in
 #ifdef DFS_TICKS_FIX
     unsigned long long numBugFix;  // Number of times the ticks bug get fixed.
 #endif
@@ -34,6 +34,7 @@ extern "C" {
 #include <sys/file.h>
 #include <sys/un.h>
 #include <sys/mman.h>
+#include <sys/uio.h>
 #ifdef HOST_i386
 #include <sys/time.h>
 #endif
@@ -170,6 +171,41 @@ WriteFile(int fd, const char *buffer, int nBytes)
     ASSERT(retVal == nBytes);
 }
 
+//----------------------------------------------------------------------
+// ReadVector/WriteVector
+// 	Read/write "numBuffers" buffers of "nBytes" characters each, into/
+//	from consecutive locations of an open file starting at "offset",
+//	in one system call.  Abort if the transfer fails or falls short.
+//----------------------------------------------------------------------
+
+void
+ReadVector(int fd, char **buffers, int numBuffers, int nBytes, int offset)
+{
+    struct iovec *vector = new struct iovec[numBuffers];
+
+    for (int i = 0; i < numBuffers; i++) {
+	vector[i].iov_base = buffers[i];
+	vector[i].iov_len = nBytes;
+    }
+    int retVal = preadv(fd, vector, numBuffers, offset);
+    delete [] vector;
+    ASSERT(retVal == numBuffers * nBytes);
+}
+
+void
+WriteVector(int fd, char **buffers, int numBuffers, int nBytes, int offset)
+{
+    struct iovec *vector = new struct iovec[numBuffers];
+
+    for (int i = 0; i < numBuffers; i++) {
+	vector[i].iov_base = buffers[i];
+	vector[i].iov_len = nBytes;
+    }
+    int retVal = pwritev(fd, vector, numBuffers, offset);
+    delete [] vector;
+    ASSERT(retVal == numBuffers * nBytes);
+}
+
 //----------------------------------------------------------------------
 // Lseek
 // 	Change the location within an open file.  Abort on error.
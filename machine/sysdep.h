@@ -25,6 +25,10 @@ extern void Read(int fd, char *buffer, int nBytes);
 extern int ReadPartial(int fd, char *buffer, int nBytes);
 extern void WriteFile(int fd, const char *buffer, int nBytes);
 extern void Lseek(int fd, int offset, int whence);
+extern void ReadVector(int fd, char **buffers, int numBuffers, int nBytes,
+			int offset);
+extern void WriteVector(int fd, char **buffers, int numBuffers, int nBytes,
+			int offset);
 extern int Tell(int fd);
 extern void Close(int fd);
 extern bool Unlink(const char *name);
@@ -219,7 +219,8 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing) {
     } else {
         stats->numTlbLookups++;
         for (entry = NULL, i = 0; i < TLBSize; i++) {
-            if (tlb[i].valid && (tlb[i].virtualPage == (int)vpn)) {
+            if (tlb[i].valid && (tlb[i].virtualPage == (int)vpn) &&
+                tlb[i].asid == asid) {
                 stats->numTlbHits++;
                 entry = &tlb[i];  // FOUND!
                 break;
@@ -241,7 +242,7 @@ Machine::Translate(int virtAddr, int* physAddr, int size, bool writing) {
 
     // if the pageFrame is too big, there is something really wrong!
     // An invalid translation was loaded into the page table or TLB.
-    if (pageFrame >= NumPhysPages) {
+    if (pageFrame >= (unsigned) NumPhysPages) {
         DEBUG('a', "*** frame %d > %d!\n", pageFrame, NumPhysPages);
         return BusErrorException;
     }
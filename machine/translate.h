@@ -40,14 +40,24 @@ class TranslationEntry {
       // page is referenced or modified.
     bool dirty;  // This bit is set by the hardware every time the
       // page is modified.
+    int asid;  // In the TLB, the address space this translation
+      // belongs to; it is only used while "machine->asid" matches.
 };
 
-#ifdef PAGING
+#ifdef USER_PROGRAM
 class AddrSpace;
 class CoreMapEntry {
  public:
+    CoreMapEntry() {
+        owner = NULL; virtualPage = -1; refCount = 0; use = false;
+    }
+
     AddrSpace* owner;
     int virtualPage;
+    int refCount;  // Number of address spaces sharing this page
+      // (it holds program code); 0 if the page is private to "owner"
+    bool use;  // Referenced since the page replacement clock hand
+      // last went past this page
 };
 #endif
 
@@ -0,0 +1,22 @@
+#include "syscall.h"
+
+char value[] = "parent\n";
+
+int main()
+{
+    SpaceId child = Clone();
+
+    if (child == 0) {
+        /* the parent must not see this */
+        value[0] = 'P';
+        value[1] = 'A';
+        Write("child: ", 7, ConsoleOutput);
+        Write(value, 7, ConsoleOutput);
+        Exit(0);
+    }
+
+    Join(child);
+    Write("parent: ", 8, ConsoleOutput);
+    Write(value, 7, ConsoleOutput);
+    Exit(0);
+}
@@ -0,0 +1,27 @@
+#include "syscall.h"
+
+void child()
+{
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        Write("child\n", 6, ConsoleOutput);
+        Yield();
+    }
+    Exit(0);
+}
+
+int main()
+{
+    SpaceId first = Fork(child);
+    SpaceId second = Fork(child);
+    int i;
+
+    for (i = 0; i < 3; i++) {
+        Write("parent\n", 7, ConsoleOutput);
+        Yield();
+    }
+    Join(first);
+    Join(second);
+    Exit(0);
+}
@@ -0,0 +1,39 @@
+#include "syscall.h"
+
+#define N 4096
+
+int data[N];
+
+void print(char* label, int n)
+{
+    char digits[12];
+    int i = 12;
+
+    while (*label != '\0')
+        Write(label++, 1, ConsoleOutput);
+    do {
+        digits[--i] = '0' + n % 10;
+        n /= 10;
+    } while (n > 0);
+    Write(digits + i, 12 - i, ConsoleOutput);
+    Write("\n", 1, ConsoleOutput);
+}
+
+int main()
+{
+    MemoryUsage usage;
+    int i, round;
+
+    /* sweep the whole array a few times, then keep to its first part */
+    for (round = 0; round < 8; round++) {
+        for (i = 0; i < (round < 4 ? N : N / 8); i++)
+            data[i] += round;
+    }
+
+    GetMemoryUsage(-1, &usage);
+    print("resident pages: ", usage.residentPages);
+    print("working set: ", usage.workingSet);
+    print("page faults: ", usage.pageFaults);
+    print("ticks: ", usage.runTicks);
+    Exit(0);
+}
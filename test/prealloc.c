@@ -0,0 +1,54 @@
+#include "syscall.h"
+
+#define CHUNK 100
+#define N 40
+
+char buffer[CHUNK];
+
+void print(char* label)
+{
+    while (*label != '\0')
+        Write(label++, 1, ConsoleOutput);
+}
+
+int main()
+{
+    OpenFileId file;
+    int i, j;
+
+    /* reserve the space for the whole file, then write it in pieces */
+    Create("prealloc.out");
+    file = Open("prealloc.out");
+    if (file < 0 || Preallocate(CHUNK * N, file) < 0) {
+        print("preallocate failed\n");
+        Exit(-1);
+    }
+    for (i = 0; i < N; i++) {
+        for (j = 0; j < CHUNK; j++)
+            buffer[j] = 'a' + (i + j) % 26;
+        Write(buffer, CHUNK, file);
+    }
+    Close(file);
+
+    /* read it back from a fresh open file */
+    file = Open("prealloc.out");
+    for (i = 0; i < N; i++) {
+        if (Read(buffer, CHUNK, file) != CHUNK) {
+            print("short file\n");
+            Exit(-1);
+        }
+        for (j = 0; j < CHUNK; j++) {
+            if (buffer[j] != 'a' + (i + j) % 26) {
+                print("wrong data\n");
+                Exit(-1);
+            }
+        }
+    }
+    if (Read(buffer, CHUNK, file) != 0) {
+        print("long file\n");
+        Exit(-1);
+    }
+    Close(file);
+    print("prealloc ok\n");
+    Exit(0);
+}
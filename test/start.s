@@ -146,6 +146,30 @@ GetNArgs:
 	j	$31
 	.end GetNArgs
 
+	.globl Clone
+	.ent	Clone
+Clone:
+	addiu $2,$0,SC_Clone
+	syscall
+	j	$31
+	.end Clone
+
+	.globl GetMemoryUsage
+	.ent	GetMemoryUsage
+GetMemoryUsage:
+	addiu $2,$0,SC_GetMemoryUsage
+	syscall
+	j	$31
+	.end GetMemoryUsage
+
+	.globl Preallocate
+	.ent	Preallocate
+Preallocate:
+	addiu $2,$0,SC_Preallocate
+	syscall
+	j	$31
+	.end Preallocate
+
 /* dummy function to keep gcc happy */
         .globl  __main
         .ent    __main
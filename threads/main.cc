@@ -9,9 +9,12 @@
 // 	Most of this file is not needed until later assignments.
 //
 // Usage: nachos -d <debugflags> -rs <random seed #>
-//		-s -x <nachos file> -c <consoleIn> <consoleOut>
+//		-s -x <nachos file> -c <consoleIn> <consoleOut> -bt
+//		-mem <physical pages> -pagesize <bytes> -stack <bytes>
+//		-tlb <fifo|lru|nru> -tlbsize <entries> -loadcontrol
 //		-f -cp <unix file> <nachos file>
-//		-p <nachos file> -r <nachos file> -l -D -t
+//		-p <nachos file> -r <nachos file> -mkdir <nachos dir>
+//		-rmdir <nachos dir> -l -D -frag -t
 //              -n <network reliability> -m <machine id>
 //              -o <other machine id>
 //              -z
@@ -24,14 +27,26 @@
 //    -s causes user programs to be executed in single-step mode
 //    -x runs a user program
 //    -c tests the console
+//    -bt times the bitmap operations
+//    -mem sets the number of physical pages, by default 32
+//    -pagesize sets the page size, by default the disk sector size;
+//      with paging, it must be a multiple of the sector size
+//    -stack sets the size of each user stack, by default 1024 bytes
+//    -tlb sets the TLB replacement policy (USE_TLB), by default lru
+//    -tlbsize sets the number of TLB entries (USE_TLB), by default 16
+//    -loadcontrol suspends processes while their working sets do not
+//      fit in memory (PAGING)
 //
 //  FILESYS
 //    -f causes the physical disk to be formatted
 //    -cp copies a file from UNIX to Nachos
 //    -p prints a Nachos file to stdout
 //    -r removes a Nachos file from the file system
-//    -l lists the contents of the Nachos directory
+//    -mkdir creates a Nachos directory
+//    -rmdir removes an empty Nachos directory
+//    -l lists the contents of the Nachos directories
 //    -D prints the contents of the entire file system 
+//    -frag reports how fragmented the files and the free space are
 //    -t tests the performance of the Nachos file system
 //
 //  NETWORK
@@ -62,6 +77,7 @@ void Print(const char *file);
 void PerformanceTest(void);
 void StartProcess(const char *file);
 void ConsoleTest(const char *in, const char *out);
+void BitMapTest();
 void MailTest(int networkID);
 
 //----------------------------------------------------------------------
@@ -111,6 +127,8 @@ main(int argc, char **argv)
 	    interrupt->Halt();		// once we start the console, then 
 					// Nachos will loop forever waiting 
 					// for console input
+	} else if (!strcmp(*argv, "-bt")) {	// time the bitmap
+	    BitMapTest();
 	}
 #endif // USER_PROGRAM
 #ifdef FILESYS
@@ -126,10 +144,20 @@ main(int argc, char **argv)
 	    ASSERT(argc > 1);
 	    fileSystem->Remove(*(argv + 1));
 	    argCount = 2;
-	} else if (!strcmp(*argv, "-l")) {	// list Nachos directory
+	} else if (!strcmp(*argv, "-mkdir")) {	// create Nachos directory
+	    ASSERT(argc > 1);
+	    fileSystem->MakeDirectory(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-rmdir")) {	// remove Nachos directory
+	    ASSERT(argc > 1);
+	    fileSystem->RemoveDirectory(*(argv + 1));
+	    argCount = 2;
+	} else if (!strcmp(*argv, "-l")) {	// list Nachos directories
             fileSystem->List();
 	} else if (!strcmp(*argv, "-D")) {	// print entire filesystem
             fileSystem->Print();
+	} else if (!strcmp(*argv, "-frag")) {	// report fragmentation
+            fileSystem->PrintFragmentation();
 	} else if (!strcmp(*argv, "-t")) {	// performance test
             PerformanceTest();
 	}
@@ -145,6 +173,9 @@ main(int argc, char **argv)
         }
 #endif // NETWORK
     }
+#ifdef FILESYS
+    fileSystem->Sync();			// save what the commands changed
+#endif
 
     currentThread->Finish();	// NOTE: if the procedure "main" 
 				// returns, then the program "nachos"
@@ -30,6 +30,7 @@ FileSystem  *fileSystem;
 
 #ifdef FILESYS
 SynchDisk   *synchDisk;
+BufferCache *bufferCache;  // Recently used sectors of the disk
 #endif
 
 #ifdef USER_PROGRAM  // requires either FILESYS or FILESYS_STUB
@@ -44,9 +45,22 @@ std::map<SpaceId, std::vector<std::string> > userProgramArgs;
 PostOffice *postOffice;
 #endif
 
+#ifdef USER_PROGRAM
+CoreMapEntry* coreMap;  // Who is using each physical page
+TextCache* textCache;  // Code pages shared between processes
+ImageCache* imageCache;  // Executables of recently run programs
+#endif
+
 #ifdef PAGING
-CoreMapEntry* coreMap;
 List<int>* loadedPages;
+SwapArea* swapArea;
+Lock* pagingLock;
+PageoutDaemon* pageoutDaemon;
+LoadControl* loadControl;  // Suspends processes when memory is overcommitted
+#endif
+
+#ifdef USE_TLB
+TlbManager* tlbManager;  // Decides what to replace on a TLB miss
 #endif
 
 // External definition, to allow us to take a pointer to this function
@@ -102,6 +116,12 @@ Initialize(int argc, char **argv) {
 #ifdef USER_PROGRAM
     bool debugUserProg = false;  // single step user program
 #endif
+#ifdef PAGING
+    bool suspendProcesses = false;  // load control
+#endif
+#ifdef USE_TLB
+    TlbPolicy tlbPolicy = kTlbLru;  // TLB replacement policy
+#endif
 #ifdef FILESYS_NEEDED
     bool format = false;  // format disk
 #endif
@@ -135,8 +155,51 @@ Initialize(int argc, char **argv) {
         }
     }
 #ifdef USER_PROGRAM
-    if (!strcmp(*argv, "-s"))
+    if (!strcmp(*argv, "-s")) {
         debugUserProg = true;
+    } else if (!strcmp(*argv, "-mem")) {
+        ASSERT(argc > 1);
+        NumPhysPages = atoi(*(argv + 1));
+        ASSERT(NumPhysPages > 0);
+        argCount = 2;
+    } else if (!strcmp(*argv, "-pagesize")) {
+        ASSERT(argc > 1);
+        PageSize = atoi(*(argv + 1));
+        ASSERT(PageSize > 0 && PageSize % 4 == 0);  // whole words
+        argCount = 2;
+    } else if (!strcmp(*argv, "-stack")) {
+        ASSERT(argc > 1);
+        UserStackSize = atoi(*(argv + 1));
+        ASSERT(UserStackSize > 0);
+        argCount = 2;
+    }
+#endif
+#ifdef PAGING
+    if (!strcmp(*argv, "-loadcontrol")) {
+        suspendProcesses = true;
+    }
+#endif
+#ifdef USE_TLB
+    if (!strcmp(*argv, "-tlbsize")) {
+        ASSERT(argc > 1);
+        TLBSize = atoi(*(argv + 1));
+        ASSERT(TLBSize > 0);
+        argCount = 2;
+    }
+#endif
+#ifdef USE_TLB
+    if (!strcmp(*argv, "-tlb")) {
+        ASSERT(argc > 1);
+        if (!strcmp(*(argv + 1), "fifo")) {
+            tlbPolicy = kTlbFifo;
+        } else if (!strcmp(*(argv + 1), "lru")) {
+            tlbPolicy = kTlbLru;
+        } else {
+            ASSERT(!strcmp(*(argv + 1), "nru"));
+            tlbPolicy = kTlbNru;
+        }
+        argCount = 2;
+    }
 #endif
 #ifdef FILESYS_NEEDED
     if (!strcmp(*argv, "-f"))
@@ -183,11 +246,15 @@ Initialize(int argc, char **argv) {
     machine = new Machine(debugUserProg);  // this must come first
     synchConsole = new SynchConsole(NULL, NULL);
     processTable = new ProcessTable();
+    // the first user program runs in the main thread, as process 0, so
+    // no process created later is ever given 0 as its identifier
+    processTable->AddProcess(currentThread);
     freeList = new BitMap(NumPhysPages);
 #endif
 
 #ifdef FILESYS
     synchDisk = new SynchDisk("DISK");
+    bufferCache = new BufferCache(synchDisk, NumCacheBuffers);
 #endif
 
 #ifdef FILESYS_NEEDED
@@ -198,9 +265,22 @@ Initialize(int argc, char **argv) {
     postOffice = new PostOffice(netname, rely, 10);
 #endif
 
-#ifdef PAGING
+#ifdef USER_PROGRAM
     coreMap = new CoreMapEntry[NumPhysPages];
+    textCache = new TextCache();
+    imageCache = new ImageCache();
+#endif
+
+#ifdef PAGING
     loadedPages = new List<int>();
+    swapArea = new SwapArea("SWAP");
+    pagingLock = new Lock("paging");
+    pageoutDaemon = new PageoutDaemon();
+    loadControl = new LoadControl(suspendProcesses);
+#endif
+
+#ifdef USE_TLB
+    tlbManager = new TlbManager(tlbPolicy);
 #endif
 }
 
@@ -231,11 +311,26 @@ Cleanup() {
 #endif
 
 #ifdef FILESYS
+    delete bufferCache;
     delete synchDisk;
 #endif
 
-#ifdef PAGING
+#ifdef USER_PROGRAM
     delete[] coreMap;
+    delete textCache;
+    delete imageCache;
+#endif
+
+#ifdef PAGING
+    delete loadedPages;
+    delete swapArea;
+    delete pagingLock;
+    delete pageoutDaemon;
+    delete loadControl;
+#endif
+
+#ifdef USE_TLB
+    delete tlbManager;
 #endif
 
     delete timer;
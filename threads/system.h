@@ -55,7 +55,9 @@ extern FileSystem  *fileSystem;
 
 #ifdef FILESYS
 #include "synchdisk.h"
+#include "buffercache.h"
 extern SynchDisk   *synchDisk;
+extern BufferCache *bufferCache;
 #endif
 
 #ifdef NETWORK
@@ -63,9 +65,32 @@ extern SynchDisk   *synchDisk;
 extern PostOffice* postOffice;
 #endif
 
-#ifdef PAGING
+#ifdef USER_PROGRAM
+#include "textcache.h"
+#include "imagecache.h"
+
 extern CoreMapEntry* coreMap;
+extern TextCache* textCache;
+extern ImageCache* imageCache;
+#endif
+
+#ifdef PAGING
+#include "swaparea.h"
+#include "pageout.h"
+#include "loadcontrol.h"
+
 extern List<int>* loadedPages;
+extern SwapArea* swapArea;
+extern PageoutDaemon* pageoutDaemon;
+extern LoadControl* loadControl;
+extern Lock* pagingLock;  // Held while handling a page fault, which may
+                          // have to wait for the swap area
+#endif
+
+#ifdef USE_TLB
+#include "tlbmanager.h"
+
+extern TlbManager* tlbManager;
 #endif
 
 #endif  // SYSTEM_H
@@ -30,9 +30,11 @@ const unsigned STACK_FENCEPOST = 0xdeadbeef;
 //  Thread::Fork.
 //
 //  "threadName" is an arbitrary string, useful for debugging.
+//  "kernelThread" is true for threads of the kernel itself, such as
+//      daemons, which are not entered in the process table.
 //----------------------------------------------------------------------
 
-Thread::Thread(const char* threadName, bool joinable) {
+Thread::Thread(const char* threadName, bool joinable, bool kernelThread) {
     name = threadName;
     stackTop = NULL;
     stack = NULL;
@@ -45,7 +47,8 @@ Thread::Thread(const char* threadName, bool joinable) {
     exitStatus = 0;
 #ifdef USER_PROGRAM
     space = NULL;
-    if (processTable) {
+    userStackSlot = 0;
+    if (processTable && !kernelThread) {
         processTable->AddProcess(this);
     }
 #endif
@@ -71,7 +74,10 @@ Thread::~Thread() {
         DeallocBoundedArray(reinterpret_cast<char *>(stack), StackSize * sizeof(HostMemoryAddress));
 
     #ifdef USER_PROGRAM
-        delete space;
+        // threads forked by a user program share its address space;
+        // the last one to go deletes it
+        if (space != NULL && space->ReleaseStack(userStackSlot))
+            delete space;
     #endif
 }
 
@@ -349,28 +355,3 @@ void Thread::setInitialPriority(int newPriority) {
     initialPriority = newPriority;
 }
 
-#ifdef USER_PROGRAM
-
-int Thread::AddFile(OpenFile* openFile) {
-    // fileDescriptor starts at 2 because 0 and 1
-    // are reserved for console output and input
-    for (int fileDescriptor = 2; fileDescriptor < MAX_OPEN_FILES_TABLE_SIZE; fileDescriptor++) {
-        if (openFilesTable[fileDescriptor] == NULL) {
-            openFilesTable[fileDescriptor] = openFile;
-            return fileDescriptor;
-        }
-    }
-    return -1;
-}
-
-OpenFile* Thread::GetFile(int fileDescriptor) {
-    return openFilesTable[fileDescriptor];
-}
-
-void Thread::RemoveFile(int fileDescriptor) {
-    OpenFile* openFile = Thread::GetFile(fileDescriptor);
-    delete openFile;
-    openFilesTable[fileDescriptor] = NULL;
-}
-
-#endif
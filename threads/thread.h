@@ -37,8 +37,6 @@
 #ifndef THREAD_H
 #define THREAD_H
 
-#include <map>
-
 #include "copyright.h"
 #include "utility.h"
 
@@ -48,8 +46,6 @@
 
 #include "filesys.h"
 #include "syscall.h"
-
-#define MAX_OPEN_FILES_TABLE_SIZE 1024
 #endif
 
 class Port;
@@ -87,7 +83,9 @@ class Thread {
     HostMemoryAddress machineState[MachineStateSize];  // all registers except for stackTop
 
  public:
-    Thread(const char* debugName, bool joinable = false);  // initialize a Thread
+    Thread(const char* debugName, bool joinable = false,
+        bool kernelThread = false);  // initialize a Thread; a kernel
+          // thread never runs user code, and takes no process id
     ~Thread();  // deallocate a Thread
           // NOTE -- thread being deleted
           // must not be running when delete
@@ -145,17 +143,12 @@ class Thread {
 
     int userRegisters[NumTotalRegs];  // user-level CPU register state
 
-    std::map<int, OpenFile*> openFilesTable;
-
  public:
     void SaveUserState();  // save user-level register state
     void RestoreUserState();  // restore user-level register state
 
     AddrSpace *space;  // User code this thread is running.
-
-    int AddFile(OpenFile* openFile);
-    OpenFile* GetFile(int fileDescriptor);
-    void RemoveFile(int fileDescriptor);
+    int userStackSlot;  // Which of the stacks in "space" this thread uses
 #endif
 };
 
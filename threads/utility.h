@@ -16,6 +16,7 @@
 //   	'a' -- address spaces (USER_PROGRAM)
 //   	'n' -- network emulation (NETWORK)
 //      'v' -- virtual memory (VM)
+//      'p' -- per-process statistics, when each process ends (USER_PROGRAM)
 //
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
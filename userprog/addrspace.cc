@@ -19,52 +19,27 @@
 #include "system.h"
 #include "addrspace.h"
 
-//----------------------------------------------------------------------
-// SwapHeader
-//  Do little endian to big endian conversion on the bytes in the
-//  object file header, in case the file was generated on a little
-//  endian machine, and we're now running on a big endian machine.
-//----------------------------------------------------------------------
-
-static void
-SwapHeader(NoffHeader *noffH) {
-    noffH->noffMagic = WordToHost(noffH->noffMagic);
-    noffH->code.size = WordToHost(noffH->code.size);
-    noffH->code.virtualAddr = WordToHost(noffH->code.virtualAddr);
-    noffH->code.inFileAddr = WordToHost(noffH->code.inFileAddr);
-    noffH->initData.size = WordToHost(noffH->initData.size);
-    noffH->initData.virtualAddr = WordToHost(noffH->initData.virtualAddr);
-    noffH->initData.inFileAddr = WordToHost(noffH->initData.inFileAddr);
-    noffH->uninitData.size = WordToHost(noffH->uninitData.size);
-    noffH->uninitData.virtualAddr = WordToHost(noffH->uninitData.virtualAddr);
-    noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
-}
+int UserStackSize = 1024;
 
 //----------------------------------------------------------------------
 // AddrSpace::AddrSpace
 //  Create an address space to run a user program.
-//  Load the program from a file "executable", and set everything
-//  up so that we can start executing user instructions.
-//
-//  Assumes that the object code file is in NOFF format.
+//  Load the program "programImage", and set everything up so that we
+//  can start executing user instructions.
 //
 //  First, set up the translation from program memory to physical
 //  memory.  For now, this is really simple (1:1), since we are
 //  only uniprogramming, and we have a single unsegmented page table
 //
-//  "executable" is the file containing the object code to load into memory
+//  "programImage" is the program to load into memory, as returned by
+//      the image cache; the address space gives it back when deleted
 //----------------------------------------------------------------------
 
-AddrSpace::AddrSpace(OpenFile *executableInput) {
-    unsigned int i, size;
-
-    executable = executableInput;
+AddrSpace::AddrSpace(ExecImage* programImage) {
+    unsigned int size;
+    NoffHeader& noffH = programImage->noffH;
 
-    executable->ReadAt(reinterpret_cast<char *>(&noffH), sizeof(noffH), 0);
-    if ((noffH.noffMagic != NOFFMAGIC) &&
-        (WordToHost(noffH.noffMagic) == NOFFMAGIC))
-        SwapHeader(&noffH);
-    ASSERT(noffH.noffMagic == NOFFMAGIC);
+    image = programImage;
 
     // how big is address space?
     size = noffH.code.size + noffH.initData.size + noffH.uninitData.size
@@ -76,66 +51,256 @@ AddrSpace::AddrSpace(OpenFile *executableInput) {
     // check we're not trying to run anything too big --
     // at least until we have virtual memory
     #ifndef USE_TLB
-    ASSERT(numPages <= NumPhysPages);
+    ASSERT(numPages <= static_cast<unsigned int>(NumPhysPages));
     #endif
 
     DEBUG('a', "Initializing address space, num pages %d, size %d\n",
         numPages, size);
 
-    // first, set up the translation
+    #ifdef PAGING
+    textCache->Attach(this);
+    #endif
+
+    // set up the translation; without demand paging, this also
+    // copies the code and data segments into memory
+    imagePages = numPages;
+    numPages = 0;
+    pageTable = NULL;
+    #ifdef DEMAND_PAGING
+    shadowTable = NULL;
+    #endif
+    #ifdef PAGING
+    swapSlots = NULL;
+    lastFault = -1;
+    prefetchWindow = 0;
+    #endif
+    useHistory = NULL;
+    bool extended = ExtendPageTable(imagePages);
+    ASSERT(extended);
+
+    // the main thread runs on the stack at the end of the image
+    stackSlots = new BitMap(MaxUserThreads);
+    stackSlots->Mark(0);
+
+    #ifdef USE_TLB
+    tlbLookups = tlbHits = 0;
+    tlbLookupsAtRestore = tlbHitsAtRestore = 0;
+    asid = -1;
+    asidGeneration = 0;
+    #endif
+
+    runTicks = 0;
+    userTicksAtRestore = stats->userTicks;
+    lastSample = 0;
+    workingSetSize = 0;
+    pageFaults = 0;
+    #ifdef PAGING
+    loadControl->Attach(this);
+    #endif
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddrSpace
+//  Create a copy of the address space "parent", for the process "pid".
+//
+//  No memory is copied: every page in memory is mapped by both address
+//  spaces and made read-only, and the first one to write to it gets its
+//  own copy (see CopyOnWrite).  Only the stack of the calling thread
+//  is in use in the new address space.
+//
+//  Pages in the swap area are copied to slots of the new address space.
+//----------------------------------------------------------------------
+
+AddrSpace::AddrSpace(AddrSpace* parent, SpaceId pid) {
+    image = parent->image;
+    imageCache->Hold(image);
+
+    imagePages = parent->imagePages;
+    numPages = parent->numPages;
     pageTable = new TranslationEntry[numPages];
     #ifdef DEMAND_PAGING
     shadowTable = new pageState[numPages];
     #endif
-    for (i = 0; i < numPages; i++) {
-        pageTable[i].virtualPage = i;
+    useHistory = new unsigned char[numPages];
+
+    stackSlots = new BitMap(MaxUserThreads);
+    stackSlots->Mark(currentThread->userStackSlot);
+
+    #ifdef USE_TLB
+    tlbLookups = tlbHits = 0;
+    tlbLookupsAtRestore = tlbHitsAtRestore = 0;
+    asid = -1;
+    asidGeneration = 0;
+    #endif
+
+    // the new process starts out with the working set of its parent
+    runTicks = 0;
+    userTicksAtRestore = stats->userTicks;
+    lastSample = 0;
+    workingSetSize = parent->workingSetSize;
+    pageFaults = 0;
+
+    DEBUG('a', "Cloning address space of %s, num pages %d\n",
+        image->name, numPages);
+
+    #ifdef PAGING
+    // copying swapped out pages waits for the disk
+    pagingLock->Acquire();
+    textCache->Attach(this);
+    swapSlots = new int[numPages];
+    lastFault = -1;
+    prefetchWindow = 0;
+    #endif
+
+    for (unsigned int i = 0; i < numPages; i++) {
+        pageTable[i] = parent->pageTable[i];
+        useHistory[i] = parent->useHistory[i];
         #ifdef DEMAND_PAGING
-        pageTable[i].physicalPage = -1;
-        pageTable[i].valid = false;
-        shadowTable[i] = kNotInMemory;
-        #else
-        pageTable[i].physicalPage = freeList->Find();
-        pageTable[i].valid = true;
+        shadowTable[i] = parent->shadowTable[i];
         #endif
-        pageTable[i].use = false;
-        pageTable[i].dirty = false;
-        // if the code segment was entirely on
-        // a separate page, we could set its
-        // pages to be read-only
-        pageTable[i].readOnly = false;
-
-        // zero out the entire address space,
-        // to zero the unitialized data segment and the stack segment
-        #ifndef DEMAND_PAGING
-        bzero(&machine->mainMemory[pageTable[i].physicalPage * PageSize],
-            PageSize);
+        #ifdef PAGING
+        swapSlots[i] = -1;
+        if (shadowTable[i] == kPrefetched)
+            shadowTable[i] = kInMemory;  // the parent loaded it ahead
         #endif
+
+        if (!pageTable[i].valid) {
+            #ifdef PAGING
+            if (shadowTable[i] == kSwappedOut) {
+                char* buffer = new char[PageSize];
+                swapArea->ReadPage(parent->swapSlots[i], buffer);
+                swapSlots[i] = swapArea->Allocate();
+                ASSERT(swapSlots[i] != -1);  // out of swap space
+                swapArea->WritePage(swapSlots[i], buffer);
+                delete[] buffer;
+            }
+            #endif
+            continue;
+        }
+
+        int physicalPage = pageTable[i].physicalPage;
+        if (IsSharedCode(i)) {
+            textCache->Share(image, i);
+            continue;
+        }
+
+        #ifdef PAGING
+        // unlike the parent, the new address space has no copy of the
+        // page in the swap area to fall back on
+        if (parent->swapSlots[i] != -1)
+            pageTable[i].dirty = true;
+        #endif
+
+        // a private page becomes shared by two address spaces
+        if (coreMap[physicalPage].refCount == 0)
+            coreMap[physicalPage].refCount = 1;
+        coreMap[physicalPage].refCount++;
+        pageTable[i].readOnly = true;
+        parent->pageTable[i].readOnly = true;
     }
 
+    #ifdef PAGING
+    pagingLock->Release();
+    loadControl->Attach(this);
+    #endif
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ExtendPageTable
+//  Grow the page table so that it maps "newNumPages" virtual pages.
+//  Without demand paging the new pages are loaded right away; with
+//  demand paging they are loaded on the first fault.
+//
+//  Return false, leaving the page table untouched, if there is not
+//  enough physical memory to back the new pages.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::ExtendPageTable(unsigned int newNumPages) {
+    unsigned int i;
+
+    ASSERT(newNumPages >= numPages);
     #ifndef DEMAND_PAGING
-    // then, copy in the code and data segments into memory
-    if (noffH.code.size > 0) {
-        DEBUG('a', "Initializing code segment, at 0x%x, size %d\n",
-            noffH.code.virtualAddr, noffH.code.size);
-        executable->ReadAt(&(machine->mainMemory[Translate(noffH.code.virtualAddr)]),
-            noffH.code.size, noffH.code.inFileAddr);
+    // code pages already loaded by another process cost nothing
+    int neededPages = 0;
+    for (i = numPages; i < newNumPages; i++) {
+        if (!IsSharedCode(i) || textCache->Find(image, i) == -1)
+            neededPages++;
     }
+    if (freeList->NumClear() < neededPages)
+        return false;
+    #endif
 
-    if (noffH.initData.size > 0) {
-        DEBUG('a', "Initializing data segment, at 0x%x, size %d\n",
-            noffH.initData.virtualAddr, noffH.initData.size);
-        executable->ReadAt(&(machine->mainMemory[Translate(noffH.initData.virtualAddr)]),
-            noffH.initData.size, noffH.initData.inFileAddr);
+    #ifdef PAGING
+    // a page fault may be waiting for the swap area with a pointer
+    // into the old table
+    pagingLock->Acquire();
+    #endif
+
+    TranslationEntry* newPageTable = new TranslationEntry[newNumPages];
+    #ifdef DEMAND_PAGING
+    pageState* newShadowTable = new pageState[newNumPages];
+    #endif
+    #ifdef PAGING
+    int* newSwapSlots = new int[newNumPages];
+    #endif
+    unsigned char* newUseHistory = new unsigned char[newNumPages];
+    for (i = 0; i < numPages; i++) {
+        newPageTable[i] = pageTable[i];
+        newUseHistory[i] = useHistory[i];
+        #ifdef DEMAND_PAGING
+        newShadowTable[i] = shadowTable[i];
+        #endif
+        #ifdef PAGING
+        newSwapSlots[i] = swapSlots[i];
+        #endif
     }
+
+    for (i = numPages; i < newNumPages; i++) {
+        newPageTable[i].virtualPage = i;
+        newPageTable[i].physicalPage = -1;
+        newPageTable[i].valid = false;
+        #ifdef DEMAND_PAGING
+        newShadowTable[i] = kNotInMemory;
+        #endif
+        #ifdef PAGING
+        newSwapSlots[i] = -1;
+        #endif
+        newPageTable[i].use = false;
+        newPageTable[i].dirty = false;
+        newPageTable[i].readOnly = false;
+        newUseHistory[i] = 0;
+    }
+
+    delete[] pageTable;
+    pageTable = newPageTable;
+    delete[] useHistory;
+    useHistory = newUseHistory;
+    #ifdef DEMAND_PAGING
+    delete[] shadowTable;
+    shadowTable = newShadowTable;
     #endif
+    #ifdef PAGING
+    delete[] swapSlots;
+    swapSlots = newSwapSlots;
+    #endif
+    #ifndef DEMAND_PAGING
+    for (i = numPages; i < newNumPages; i++)
+        LoadPage(i);
+    #endif
+    numPages = newNumPages;
 
+    #ifndef USE_TLB
+    // the machine may be running on the old table
+    if (currentThread->space == this) {
+        machine->pageTable = pageTable;
+        machine->pageTableSize = numPages;
+    }
+    #endif
     #ifdef PAGING
-    SpaceId pid = processTable->GetPID(currentThread);
-    swapName = new char[128];
-    snprintf(swapName, 128, "SWAP.%d", pid);
-    fileSystem->Create(swapName, size);
-    swap = fileSystem->Open(swapName);
+    pagingLock->Release();
     #endif
+    return true;
 }
 
 //----------------------------------------------------------------------
@@ -144,28 +309,63 @@ AddrSpace::AddrSpace(OpenFile *executableInput) {
 //----------------------------------------------------------------------
 
 AddrSpace::~AddrSpace() {
+    DEBUG('p', "Process running %s: %d page faults in %d ticks, working "
+        "set %d pages\n", image->name, pageFaults, VirtualTime(),
+        workingSetSize);
+
+    #ifdef USE_TLB
+    if (tlbLookups > 0) {
+        DEBUG('p', "Process running %s: TLB lookups %d, misses %d, "
+            "miss ratio %f\n", image->name, tlbLookups, tlbLookups - tlbHits,
+            (tlbLookups - tlbHits) * 1.0 / tlbLookups);
+    }
+    tlbManager->Release(this);
+    #endif
+
+    #ifdef PAGING
+    // a page of this address space may be being written to the swap
+    // area; it is already unmapped, and nothing else about this
+    // address space is looked at once the write is over
+    textCache->Detach(this);
+    loadControl->Detach(this);
+    #endif
+
     for (unsigned int i = 0; i < numPages; i++) {
+        #ifdef PAGING
+        if (swapSlots[i] != -1)
+            swapArea->Free(swapSlots[i]);
+        #endif
         if (pageTable[i].valid) {
+            int physicalPage = pageTable[i].physicalPage;
             DEBUG('v', "Clearing virtual page number %d from physical page number %d\n",
-                pageTable[i].virtualPage,
-                pageTable[i].physicalPage);
-            freeList->Clear(pageTable[i].physicalPage);
-            #ifdef PAGING
-            coreMap[pageTable[i].physicalPage].owner = NULL;
-            coreMap[pageTable[i].physicalPage].virtualPage = -1;
-            #endif
+                pageTable[i].virtualPage, physicalPage);
+            // shared pages are freed by the last process using them
+            if (IsSharedCode(i)) {
+                if (!textCache->Release(physicalPage))
+                    continue;
+            } else if (coreMap[physicalPage].refCount > 0 &&
+                --coreMap[physicalPage].refCount > 0) {
+                continue;
+            }
+            freeList->Clear(physicalPage);
+            coreMap[physicalPage].owner = NULL;
+            coreMap[physicalPage].virtualPage = -1;
         }
     }
+    for (std::map<int, OpenFile*>::iterator it = openFilesTable.begin();
+        it != openFilesTable.end(); ++it)
+        delete it->second;
     delete[] pageTable;
+    delete[] useHistory;
+    delete stackSlots;
+    imageCache->Release(image);
 
     #ifdef DEMAND_PAGING
     delete[] shadowTable;
     #endif
 
     #ifdef PAGING
-    fileSystem->Remove(swapName);
-    delete[] swapName;
-    delete swap;
+    delete[] swapSlots;
     #endif
 }
 
@@ -196,8 +396,113 @@ AddrSpace::InitRegisters() {
     // Set the stack register to the end of the address space, where we
     // allocated the stack; but subtract off a bit, to make sure we don't
     // accidentally reference off the end!
-    machine->WriteRegister(StackReg, numPages * PageSize - 16);
-    DEBUG('a', "Initializing stack register to %d\n", numPages * PageSize - 16);
+    machine->WriteRegister(StackReg, imagePages * PageSize - 16);
+    DEBUG('a', "Initializing stack register to %d\n", imagePages * PageSize - 16);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AllocateStack
+//  Reserve a user stack for a new thread that will share this address
+//  space.  Slot 0 is the stack of the main thread, at the end of the
+//  program image; slot i is laid out right after slot i - 1, and the
+//  page table is grown to cover it the first time it is used.
+//
+//  Return the slot number, or -1 if the address space already runs
+//  MaxUserThreads threads or there is no memory left for the stack.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::AllocateStack() {
+    int slot = stackSlots->Find();
+    if (slot == -1)
+        return -1;
+
+    unsigned int stackPages = divRoundUp(UserStackSize, PageSize);
+    unsigned int neededPages = imagePages + slot * stackPages;
+    if (neededPages > numPages && !ExtendPageTable(neededPages)) {
+        stackSlots->Clear(slot);
+        return -1;
+    }
+
+    DEBUG('a', "Allocated user stack slot %d\n", slot);
+    return slot;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::ReleaseStack
+//  Free the stack slot of a thread that is going away.  The pages are
+//  kept mapped, so the next thread forked into this slot reuses them.
+//
+//  Return true if that was the last thread in the address space, in
+//  which case the caller should delete it.
+//----------------------------------------------------------------------
+
+bool
+AddrSpace::ReleaseStack(int slot) {
+    stackSlots->Clear(slot);
+    return stackSlots->NumClear() == MaxUserThreads;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AddFile
+//  Give "openFile" the lowest free file descriptor of the process, and
+//  return it, or -1 if the process has too many files open.  The
+//  descriptors 0 and 1 are the console.
+//----------------------------------------------------------------------
+
+int
+AddrSpace::AddFile(OpenFile* openFile) {
+    for (int fileDescriptor = 2; fileDescriptor < MAX_OPEN_FILES_TABLE_SIZE;
+        fileDescriptor++) {
+        if (openFilesTable[fileDescriptor] == NULL) {
+            openFilesTable[fileDescriptor] = openFile;
+            return fileDescriptor;
+        }
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::GetFile
+//  Return the file open as "fileDescriptor", or NULL.
+//----------------------------------------------------------------------
+
+OpenFile*
+AddrSpace::GetFile(int fileDescriptor) {
+    return openFilesTable[fileDescriptor];
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::RemoveFile
+//  Close the file open as "fileDescriptor", freeing the descriptor.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::RemoveFile(int fileDescriptor) {
+    delete GetFile(fileDescriptor);
+    openFilesTable[fileDescriptor] = NULL;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::InitThreadRegisters
+//  Set the initial values for the user-level register set of a thread
+//  forked inside this address space.  It starts at the user procedure
+//  "func", with the stack pointer at the top of stack slot "slot".
+//----------------------------------------------------------------------
+
+void
+AddrSpace::InitThreadRegisters(int func, int slot) {
+    unsigned int stackPages = divRoundUp(UserStackSize, PageSize);
+    int stackTop = (imagePages + slot * stackPages) * PageSize;
+
+    for (int i = 0; i < NumTotalRegs; i++)
+        machine->WriteRegister(i, 0);
+
+    machine->WriteRegister(PCReg, func);
+    machine->WriteRegister(NextPCReg, func + 4);
+    machine->WriteRegister(StackReg, stackTop - 16);
+    DEBUG('a', "Initializing thread at 0x%x, stack register to %d\n",
+        func, stackTop - 16);
 }
 
 //----------------------------------------------------------------------
@@ -205,36 +510,151 @@ AddrSpace::InitRegisters() {
 //  On a context switch, save any machine state, specific
 //  to this address space, that needs saving.
 //
-//  For now, nothing!
+//  With a TLB, that is the use and dirty bits of our translations in
+//  it, and the TLB lookups made while this address space was running.
+//  The translations themselves stay, tagged with our ASID.
+//
+//  The user ticks run since the last restore are added to the virtual
+//  time of the address space, which paces its working set samples.
 //----------------------------------------------------------------------
 
 void AddrSpace::SaveState() {
     #ifdef USE_TLB
     for (int i = 0; i < TLBSize; i++) {
-        if (machine->tlb[i].valid && machine->tlb[i].dirty) {
-            pageTable[machine->tlb[i].virtualPage] = machine->tlb[i];
-        }
+        SaveTlbEntry(&machine->tlb[i]);
     }
+    tlbLookups += stats->numTlbLookups - tlbLookupsAtRestore;
+    tlbHits += stats->numTlbHits - tlbHitsAtRestore;
+    tlbLookupsAtRestore = stats->numTlbLookups;
+    tlbHitsAtRestore = stats->numTlbHits;
     #endif
+    runTicks += stats->userTicks - userTicksAtRestore;
+    userTicksAtRestore = stats->userTicks;
+    SampleWorkingSet();
 }
 
+#ifdef USE_TLB
+//----------------------------------------------------------------------
+// AddrSpace::SaveTlbEntry
+//  Merge the use and dirty bits of the TLB translation "entry" into
+//  the page table, if it is still a translation of this address space.
+//----------------------------------------------------------------------
+
+void AddrSpace::SaveTlbEntry(TranslationEntry* entry) {
+    if (!entry->valid || entry->asid != asid)
+        return;
+
+    TranslationEntry* page = &pageTable[entry->virtualPage];
+    if (page->valid && page->physicalPage == entry->physicalPage) {
+        page->use = page->use || entry->use;
+        page->dirty = page->dirty || entry->dirty;
+        if (entry->use)
+            coreMap[entry->physicalPage].use = true;
+    }
+}
+#endif
+
 //----------------------------------------------------------------------
 // AddrSpace::RestoreState
 //  On a context switch, restore the machine state so that
 //  this address space can run.
 //
-//  For now, tell the machine where to find the page table.
+//  Without a TLB, tell the machine where to find the page table; with
+//  one, which ASID its translations are tagged with.
 //----------------------------------------------------------------------
 
 void AddrSpace::RestoreState() {
     #ifdef USE_TLB
-    for (int i = 0; i < TLBSize; i++) {
-        machine->tlb[i].valid = false;
-    }
+    tlbManager->Activate(this);
+    stats->numContextSwitches++;
+    tlbLookupsAtRestore = stats->numTlbLookups;
+    tlbHitsAtRestore = stats->numTlbHits;
     #else
         machine->pageTable = pageTable;
         machine->pageTableSize = numPages;
     #endif
+    userTicksAtRestore = stats->userTicks;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::VirtualTime
+//  Return the user ticks run in this address space so far, including
+//  those since the last context switch if it is running now.
+//----------------------------------------------------------------------
+
+int AddrSpace::VirtualTime() {
+    if (currentThread->space == this)
+        return runTicks + stats->userTicks - userTicksAtRestore;
+    return runTicks;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::SampleWorkingSet
+//  Estimate the working set of the address space: the pages used in
+//  the last WorkingSetSamples intervals of its virtual time.
+//
+//  At the end of each interval, the use bits of the pages are shifted
+//  into their history and cleared.  Several intervals may have gone by
+//  since the last sample; pages are only known to have been used in
+//  the last one of them.
+//----------------------------------------------------------------------
+
+void AddrSpace::SampleWorkingSet() {
+    int intervals = (VirtualTime() - lastSample) / WorkingSetInterval;
+    if (intervals == 0)
+        return;
+    lastSample += intervals * WorkingSetInterval;
+
+    #ifdef USE_TLB
+    // translations in the TLB hold the latest use bits
+    for (int i = 0; i < TLBSize; i++) {
+        TranslationEntry* entry = &machine->tlb[i];
+        if (entry->valid && entry->asid == asid) {
+            SaveTlbEntry(entry);
+            entry->use = false;
+        }
+    }
+    #endif
+
+    workingSetSize = 0;
+    for (unsigned int i = 0; i < numPages; i++) {
+        if (intervals < WorkingSetSamples)
+            useHistory[i] >>= intervals;
+        else
+            useHistory[i] = 0;
+        if (pageTable[i].use)
+            useHistory[i] |= 1 << (WorkingSetSamples - 1);
+        pageTable[i].use = false;
+        if (useHistory[i] != 0)
+            workingSetSize++;
+    }
+    if (workingSetSize > stats->maxWorkingSet)
+        stats->maxWorkingSet = workingSetSize;
+
+    DEBUG('v', "Working set of %s: %d pages\n", image->name, workingSetSize);
+    #ifdef PAGING
+    loadControl->Update();
+    #endif
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::GetUsage
+//  Fill in "usage" with the pages of this address space in memory,
+//  its latest working set estimate, its page faults and the user ticks
+//  it has run.
+//----------------------------------------------------------------------
+
+void AddrSpace::GetUsage(MemoryUsage* usage) {
+    SampleWorkingSet();
+
+    usage->residentPages = 0;
+    for (unsigned int i = 0; i < numPages; i++) {
+        if (pageTable[i].valid)
+            usage->residentPages++;
+    }
+    usage->workingSet = workingSetSize;
+    usage->pageFaults = pageFaults;
+    usage->runTicks = VirtualTime();
 }
 
 int AddrSpace::Translate(int virtualAddress) {
@@ -243,107 +663,425 @@ int AddrSpace::Translate(int virtualAddress) {
     return pageTable[virtualPage].physicalPage * PageSize + offset;
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::GetPage
+//  Return the translation of "virtualPage", bringing the page into
+//  memory first if it is not there.
+//
+//  With paging, faults also load the pages that follow, when recent
+//  faults have been sequential (see Prefetch).  A page loaded ahead is
+//  only counted as a fault when it gets used.
+//----------------------------------------------------------------------
+
 TranslationEntry* AddrSpace::GetPage(int virtualPage) {
+    SampleWorkingSet();
+
     #ifdef DEMAND_PAGING
     switch (shadowTable[virtualPage]) {
         case kNotInMemory:
+            stats->numPageFaults++;
+            pageFaults++;
+            #ifdef PAGING
+            AdaptPrefetchWindow(virtualPage);
+            #endif
             LoadPage(virtualPage);
             break;
         case kInMemory:
-            break;
+            return &pageTable[virtualPage];
         #ifdef PAGING
         case kSwappedOut:
+            stats->numPageFaults++;
+            stats->numSwapFaults++;
+            pageFaults++;
+            AdaptPrefetchWindow(virtualPage);
             SwapIn(virtualPage);
             break;
+        case kPrefetched:
+            // the fault it saved still calls for the next pages
+            stats->numPrefetchHits++;
+            pageFaults++;
+            lastFault = virtualPage;
+            shadowTable[virtualPage] = kInMemory;
+            break;
         #endif
         default:
             break;
     }
+    #ifdef PAGING
+    Prefetch(virtualPage);
+    #endif
     #endif
     return &pageTable[virtualPage];
 }
 
-#ifdef DEMAND_PAGING
-void AddrSpace::LoadPage(int virtualPage) {
-    int virtualAddress = virtualPage * PageSize;
-    pageTable[virtualPage].physicalPage = freeList->Find();
+//----------------------------------------------------------------------
+// AddrSpace::IsSharedCode
+//  Return true if "virtualPage" lies entirely inside the code segment.
+//  Such a page is the same for every process running this program,
+//  so they can all map a single read-only copy of it.
+//----------------------------------------------------------------------
 
-    #ifdef PAGING
-    if (pageTable[virtualPage].physicalPage == -1) {
-        int victimPhysicalPage = MakeRoom();
-        freeList->Mark(victimPhysicalPage);
-        pageTable[virtualPage].physicalPage = victimPhysicalPage;
+bool
+AddrSpace::IsSharedCode(int virtualPage) {
+    int start = virtualPage * PageSize;
+    Segment* code = &image->noffH.code;
+    return code->size > 0 && start >= code->virtualAddr &&
+        start + PageSize <= code->virtualAddr + code->size;
+}
+
+//----------------------------------------------------------------------
+// SegmentInPage
+//  Find the virtual addresses [*start, *end) of "segment" that fall
+//  inside "virtualPage".  Return how many bytes that is.
+//----------------------------------------------------------------------
+
+static int
+SegmentInPage(int virtualPage, Segment* segment, int* start, int* end) {
+    int pageStart = virtualPage * PageSize;
+    int pageEnd = pageStart + PageSize;
+    int segmentEnd = segment->virtualAddr + segment->size;
+    *start = pageStart > segment->virtualAddr ? pageStart : segment->virtualAddr;
+    *end = pageEnd < segmentEnd ? pageEnd : segmentEnd;
+    return *start < *end ? *end - *start : 0;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LoadSegment
+//  Copy the bytes of "segment" that fall inside "virtualPage" from its
+//  "contents" in the program image into the physical page it is mapped
+//  to.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::LoadSegment(int virtualPage, Segment* segment, char* contents) {
+    int start, end;
+    if (SegmentInPage(virtualPage, segment, &start, &end) == 0)
+        return;
+
+    memcpy(&(machine->mainMemory[Translate(start)]),
+        &contents[start - segment->virtualAddr], end - start);
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::LoadPage
+//  Map "virtualPage" to a physical page holding its initial contents:
+//  code and initialized data come from the program image, everything else
+//  is zero.  Code pages are shared with any other process that has
+//  already loaded them.
+//
+//  Pages of the uninitialized data segment and of the stacks are just
+//  zero-filled; only the bytes not covered by code or data are zeroed.
+//----------------------------------------------------------------------
+
+void
+AddrSpace::LoadPage(int virtualPage, bool prefetch) {
+    bool shared = IsSharedCode(virtualPage);
+    int physicalPage = shared ? textCache->Share(image, virtualPage) : -1;
+
+    if (physicalPage == -1) {
+        #ifdef PAGING
+        physicalPage = AllocateFrame();
+        #else
+        physicalPage = freeList->Find();
+        #endif
+        ASSERT(physicalPage != -1);
+        pageTable[virtualPage].physicalPage = physicalPage;
+
+        DEBUG('v', "Loading virtual page number %d into physical page number %d\n",
+            virtualPage, physicalPage);
+
+        int start, end;
+        int imageBytes =
+            SegmentInPage(virtualPage, &image->noffH.code, &start, &end) +
+            SegmentInPage(virtualPage, &image->noffH.initData, &start, &end);
+        if (imageBytes < PageSize)
+            bzero(&machine->mainMemory[physicalPage * PageSize], PageSize);
+        LoadSegment(virtualPage, &image->noffH.code, image->code);
+        LoadSegment(virtualPage, &image->noffH.initData, image->initData);
+
+        #ifdef DEMAND_PAGING
+        if (!prefetch) {
+            if (imageBytes == 0)
+                stats->numZeroFillFaults++;
+            else
+                stats->numLoadFaults++;
+        }
+        #endif
+
+        if (shared) {
+            textCache->Add(image, virtualPage, physicalPage);
+        } else {
+            coreMap[physicalPage].owner = this;
+            coreMap[physicalPage].virtualPage = virtualPage;
+        }
+        // a page loaded ahead is the first to go if it is not used
+        coreMap[physicalPage].use = !prefetch;
+        #if defined(PAGING) && !defined(CLOCK_ALGORITHM)
+        loadedPages->Append(physicalPage);
+        #endif
+    } else {
+        pageTable[virtualPage].physicalPage = physicalPage;
+        DEBUG('v', "Mapping virtual page number %d to shared physical page number %d\n",
+            virtualPage, physicalPage);
+        #ifdef DEMAND_PAGING
+        if (!prefetch)
+            stats->numSharedFaults++;
+        #endif
     }
 
-    coreMap[pageTable[virtualPage].physicalPage].owner = this;
-    coreMap[pageTable[virtualPage].physicalPage].virtualPage = virtualPage;
+    pageTable[virtualPage].readOnly = shared;
+    pageTable[virtualPage].dirty = false;
+    pageTable[virtualPage].valid = true;
+    #ifdef DEMAND_PAGING
+    shadowTable[virtualPage] = prefetch ? kPrefetched : kInMemory;
     #endif
+}
 
-    DEBUG('v', "Loading virtual page number %d into physical page number %d\n",
-        virtualPage, pageTable[virtualPage].physicalPage);
+//----------------------------------------------------------------------
+// AddrSpace::CopyOnWrite
+//  Handle a write to the read-only page "virtualPage".  If the page is
+//  still shared with a cloned address space, give this address space a
+//  private copy of it; if not, just make it writable again.
+//
+//  Return false if the page really is read-only, because it holds code.
+//----------------------------------------------------------------------
 
-    if (noffH.code.size > 0) {
-        executable->ReadAt(&(machine->mainMemory[Translate(virtualAddress)]),
-            PageSize,
-            noffH.code.inFileAddr + virtualAddress - noffH.code.virtualAddr);
-    }
+bool
+AddrSpace::CopyOnWrite(int virtualPage) {
+    if (IsSharedCode(virtualPage) || !pageTable[virtualPage].valid ||
+        !pageTable[virtualPage].readOnly)
+        return false;
+
+    stats->numCopyOnWriteFaults++;
+    int physicalPage = pageTable[virtualPage].physicalPage;
+    if (coreMap[physicalPage].refCount > 1) {
+        #ifdef PAGING
+        // this may evict the shared page itself, leaving its contents
+        // in the frame we get back
+        int copyPage = AllocateFrame();
+        #else
+        int copyPage = freeList->Find();
+        #endif
+        ASSERT(copyPage != -1);
 
-    if (noffH.initData.size > 0) {
-        executable->ReadAt(&(machine->mainMemory[Translate(virtualAddress)]),
-            PageSize,
-            noffH.initData.inFileAddr + virtualAddress - noffH.initData.virtualAddr);
+        if (copyPage != physicalPage) {
+            DEBUG('v', "Copying virtual page number %d from physical page %d to %d\n",
+                virtualPage, physicalPage, copyPage);
+            memcpy(&machine->mainMemory[copyPage * PageSize],
+                &machine->mainMemory[physicalPage * PageSize], PageSize);
+            coreMap[physicalPage].refCount--;
+        }
+        #if defined(PAGING) && !defined(CLOCK_ALGORITHM)
+        loadedPages->Append(copyPage);
+        #endif
+        physicalPage = copyPage;
     }
 
+    coreMap[physicalPage].owner = this;
+    coreMap[physicalPage].virtualPage = virtualPage;
+    coreMap[physicalPage].refCount = 0;
+    coreMap[physicalPage].use = true;
+    pageTable[virtualPage].physicalPage = physicalPage;
     pageTable[virtualPage].valid = true;
-    loadedPages->Append(pageTable[virtualPage].physicalPage);
+    pageTable[virtualPage].readOnly = false;
+    #ifdef DEMAND_PAGING
     shadowTable[virtualPage] = kInMemory;
+    #endif
+
+    #ifdef USE_TLB
+    // give the write that faulted the new translation, so that it does
+    // not miss in the TLB once more
+    for (int i = 0; i < TLBSize; i++) {
+        if (machine->tlb[i].valid &&
+            machine->tlb[i].virtualPage == virtualPage &&
+            machine->tlb[i].asid == asid) {
+            machine->tlb[i].physicalPage = physicalPage;
+            machine->tlb[i].readOnly = false;
+        }
+    }
+    #endif
+    return true;
 }
-#endif
 
 #ifdef PAGING
-void AddrSpace::SwapIn(int virtualPage) {
-    int virtualAddress = virtualPage * PageSize;
-    int physicalPage = freeList->Find();
-    if (physicalPage == -1) {
-        physicalPage = MakeRoom();
-    }
-    int physicalAddress = physicalPage * PageSize;
-    pageTable[virtualPage].physicalPage = physicalPage;
+//----------------------------------------------------------------------
+// AddrSpace::SwapIn
+//  Bring "virtualPage" back from the swap area into a physical page.
+//  "prefetch" is true if it is loaded ahead of a fault.
+//----------------------------------------------------------------------
 
-    freeList->Mark(physicalPage);
+void AddrSpace::SwapIn(int virtualPage, bool prefetch) {
+    int physicalPage = AllocateFrame();
+    swapArea->ReadPage(swapSlots[virtualPage],
+        &machine->mainMemory[physicalPage * PageSize]);
+    DEBUG('v', "Swapped virtual page %d in from slot %d to physical page %d\n",
+        virtualPage, swapSlots[virtualPage], physicalPage);
 
     coreMap[physicalPage].owner = this;
     coreMap[physicalPage].virtualPage = virtualPage;
+    coreMap[physicalPage].use = !prefetch;
+    pageTable[virtualPage].physicalPage = physicalPage;
+    pageTable[virtualPage].dirty = false;
     pageTable[virtualPage].valid = true;
-
-    swap->ReadAt(&(machine->mainMemory[physicalAddress]),
-        PageSize, virtualAddress);
-    DEBUG('v', "Swapped physical page %d in.\n", physicalPage);
+    #ifndef CLOCK_ALGORITHM
     loadedPages->Append(physicalPage);
-    shadowTable[virtualPage] = kInMemory;
+    #endif
+    shadowTable[virtualPage] = prefetch ? kPrefetched : kInMemory;
 }
 
+//----------------------------------------------------------------------
+// AddrSpace::SwapOut
+//  Evict "virtualPage" to the swap area, giving it a slot there the
+//  first time, and free its physical page.
+//
+//  The page is unmapped before it is written, since other threads run
+//  while the disk is busy.
+//----------------------------------------------------------------------
+
 void AddrSpace::SwapOut(int virtualPage) {
     int physicalPage = pageTable[virtualPage].physicalPage;
-    int virtualAddress = virtualPage * PageSize;
-    int physicalAddress = physicalPage * PageSize;
 
-    swap->WriteAt(&(machine->mainMemory[physicalAddress]),
-        PageSize, virtualAddress);
-    DEBUG('v', "Swapped physical page %d out.\n", physicalPage);
-    freeList->Clear(physicalPage);
+    // the TLB may know the page was written to
+    for (int i = 0; i < TLBSize; i++) {
+        if (machine->tlb[i].physicalPage == physicalPage) {
+            SaveTlbEntry(&machine->tlb[i]);
+            machine->tlb[i].valid = false;
+        }
+    }
     pageTable[virtualPage].valid = false;
     pageTable[virtualPage].physicalPage = -1;
+    PrefetchWasted(virtualPage);
+
+    PageOut(virtualPage, physicalPage);
+    freeList->Clear(physicalPage);
     coreMap[physicalPage].owner = NULL;
     coreMap[physicalPage].virtualPage = -1;
-    for (int i = 0; i < TLBSize; i++) {
-        if (machine->tlb[i].physicalPage == physicalPage) {
-            machine->tlb[i].valid = false;
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::PageOut
+//  Save the contents of "physicalPage", holding "virtualPage", which is
+//  being evicted.
+//
+//  Only pages modified since they were loaded are written to the swap
+//  area.  A clean page is just dropped: if it came from the swap area,
+//  its slot still has the same contents; if not, it is loaded again
+//  from the program image, or zero-filled.
+//----------------------------------------------------------------------
+
+void AddrSpace::PageOut(int virtualPage, int physicalPage) {
+    if (!pageTable[virtualPage].dirty) {
+        DEBUG('v', "Dropping clean virtual page %d from physical page %d\n",
+            virtualPage, physicalPage);
+        stats->numCleanEvictions++;
+        shadowTable[virtualPage] =
+            swapSlots[virtualPage] == -1 ? kNotInMemory : kSwappedOut;
+        return;
+    }
+
+    if (swapSlots[virtualPage] == -1) {
+        swapSlots[virtualPage] = swapArea->Allocate();
+        ASSERT(swapSlots[virtualPage] != -1);  // out of swap space
+    }
+    DEBUG('v', "Swapping virtual page %d out from physical page %d to slot %d\n",
+        virtualPage, physicalPage, swapSlots[virtualPage]);
+    stats->numSwapWrites++;
+    pageTable[virtualPage].dirty = false;
+    shadowTable[virtualPage] = kSwappedOut;
+    swapArea->WritePage(swapSlots[virtualPage],
+        &machine->mainMemory[physicalPage * PageSize]);
+}
+
+void AddrSpace::UnmapSharedPage(int virtualPage, int physicalPage) {
+    if (virtualPage >= static_cast<int>(numPages) ||
+        !pageTable[virtualPage].valid ||
+        pageTable[virtualPage].physicalPage != physicalPage)
+        return;
+
+    pageTable[virtualPage].valid = false;
+    pageTable[virtualPage].physicalPage = -1;
+    PrefetchWasted(virtualPage);
+    if (IsSharedCode(virtualPage)) {
+        // it can be loaded again from the program image
+        shadowTable[virtualPage] = kNotInMemory;
+    } else {
+        // a copy-on-write page: from now on each process has its own
+        PageOut(virtualPage, physicalPage);
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::Prefetch
+//  Load the pages following "virtualPage" that are not in memory, up
+//  to "prefetchWindow" of them, so that a program going through its
+//  memory in order finds them there.  Pages read back from the swap
+//  area usually sit in consecutive slots, which the disk reads from
+//  its track buffer.
+//
+//  Pages are only loaded into free physical pages: nothing is evicted
+//  to make room for a page that may never be used.
+//----------------------------------------------------------------------
+
+void AddrSpace::Prefetch(int virtualPage) {
+    int last = virtualPage + prefetchWindow;
+    if (last >= static_cast<int>(numPages))
+        last = numPages - 1;
+
+    for (int page = virtualPage + 1; page <= last; page++) {
+        if (freeList->NumClear() <= PageoutLowWater)
             break;
+        if (shadowTable[page] == kNotInMemory) {
+            LoadPage(page, true);
+        } else if (shadowTable[page] == kSwappedOut) {
+            SwapIn(page, true);
+        } else {
+            continue;
         }
+        DEBUG('v', "Prefetched virtual page %d\n", page);
+        stats->numPrefetches++;
     }
+}
 
-    shadowTable[virtualPage] = kSwappedOut;
+//----------------------------------------------------------------------
+// AddrSpace::AdaptPrefetchWindow
+//  Grow the prefetch window when a fault follows the previous one in
+//  order, doubling it up to MaxPrefetchPages, and shrink it when not.
+//  Prefetched pages evicted unused shrink it too (see PrefetchWasted),
+//  so the window follows how many of them turn out useful.
+//----------------------------------------------------------------------
+
+void AddrSpace::AdaptPrefetchWindow(int virtualPage) {
+    if (virtualPage == lastFault + 1) {
+        prefetchWindow = prefetchWindow == 0 ? 1 : prefetchWindow * 2;
+        if (prefetchWindow > MaxPrefetchPages)
+            prefetchWindow = MaxPrefetchPages;
+    } else {
+        prefetchWindow /= 2;
+    }
+    lastFault = virtualPage;
+}
+
+void AddrSpace::PrefetchWasted(int virtualPage) {
+    if (shadowTable[virtualPage] == kPrefetched) {
+        DEBUG('v', "Prefetched virtual page %d evicted unused\n", virtualPage);
+        prefetchWindow /= 2;
+    }
+}
+
+//----------------------------------------------------------------------
+// AddrSpace::AllocateFrame
+//  Return a free physical page, marked as in use.  Normally the pageout
+//  daemon keeps a few pages free; if there are none left, evict one.
+//----------------------------------------------------------------------
+
+int AddrSpace::AllocateFrame() {
+    int physicalPage = freeList->Find();
+    if (physicalPage == -1) {
+        physicalPage = MakeRoom();
+        freeList->Mark(physicalPage);
+    }
+    pageoutDaemon->Check();
+    return physicalPage;
 }
 
 int AddrSpace::MakeRoom() {
@@ -353,34 +1091,41 @@ int AddrSpace::MakeRoom() {
     int victimPhysicalPage = loadedPages->Remove();
     #endif
     int victimVirtualPage = coreMap[victimPhysicalPage].virtualPage;
-    coreMap[victimPhysicalPage].owner->SwapOut(victimVirtualPage);
+    if (coreMap[victimPhysicalPage].refCount > 0)
+        textCache->Evict(victimPhysicalPage);
+    else
+        coreMap[victimPhysicalPage].owner->SwapOut(victimVirtualPage);
     return victimPhysicalPage;
 }
 
-struct loadedPageState {
-    int use, dirty;
-    loadedPageState(int useVal, int dirtyVal) {
-        use = useVal;
-        dirty = dirtyVal;
-    }
-};
-
-int AddrSpace::Clock() {
-    int candidatePage;
-    TranslationEntry candidatePageInfo;
-    loadedPageState loadedPageStates[4] = {{0, 0}, {0, 1}, {1, 0}, {1, 1}};
-    for (int i = 0; i < 4; i++) {
-        for (int j = 0; j < NumPhysPages; j++) {
-            candidatePage = loadedPages->Remove();
-            candidatePageInfo = pageTable[candidatePage];
-            if (candidatePageInfo.use == loadedPageStates[i].use &&
-                candidatePageInfo.dirty == loadedPageStates[i]. dirty) {
-                    return candidatePage;
-                }
-            loadedPages->Prepend(candidatePage);
-        }
+//----------------------------------------------------------------------
+// AddrSpace::Clock
+//  Choose a physical page to evict, using the clock algorithm over the
+//  core map.  The hand keeps its position from one call to the next,
+//  and sweeps past pages referenced since it last went by, clearing
+//  their use bits, until it finds one that was not.  It looks at every
+//  page at most twice, and usually at just a few.
+//
+//  Use bits are kept per physical page, so that pages shared by several
+//  address spaces have just one; references still in the TLB are
+//  collected first.
+//----------------------------------------------------------------------
+
+static int clockHand = 0;  // Next physical page the clock looks at
+
+int
+AddrSpace::Clock() {
+    tlbManager->CollectUseBits();
+
+    for (;;) {
+        int candidatePage = clockHand;
+        clockHand = (clockHand + 1) % NumPhysPages;
+        if (!freeList->Test(candidatePage))
+            continue;  // the pageout daemon may leave pages free
+        if (!coreMap[candidatePage].use)
+            return candidatePage;
+        coreMap[candidatePage].use = false;
     }
-    return -1;
 }
 
 #endif
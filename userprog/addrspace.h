@@ -13,23 +13,38 @@
 #ifndef ADDRSPACE_H
 #define ADDRSPACE_H
 
+#include <map>
+
 #include "copyright.h"
-#include "filesys.h"
-#include "noff.h"
+#include "imagecache.h"
+#include "bitmap.h"
+#include "syscall.h"
+
+extern int UserStackSize;  // 1024 by default; increase this as necessary!
+#define MaxUserThreads 8  // Threads that can share one address space
+#define MaxPrefetchPages 8  // Most pages loaded ahead of a fault
+#define MAX_OPEN_FILES_TABLE_SIZE 1024
 
-#define UserStackSize 1024  // Increase this as necessary!
+// The working set of a process is the pages it used in its last
+// WorkingSetSamples periods of WorkingSetInterval user ticks
+#define WorkingSetInterval 1000
+#define WorkingSetSamples 8
 
 enum pageState {
     kNotInMemory,
     kInMemory,
-    kSwappedOut
+    kSwappedOut,
+    kPrefetched  // In memory, loaded ahead and not used yet
 };
 
 class AddrSpace {
  public:
     // Create an address space, initializing it with the program
-    // stored in the file "executable"
-    explicit AddrSpace(OpenFile *executable);
+    // "image", obtained from the image cache
+    explicit AddrSpace(ExecImage* image);
+
+    // Create a copy-on-write clone of "parent" for the process "pid"
+    AddrSpace(AddrSpace* parent, SpaceId pid);
 
     // De-allocate an address space
     ~AddrSpace();
@@ -37,23 +52,76 @@ class AddrSpace {
     // Initialize user-level CPU registers, before jumping to user code
     void InitRegisters();
 
+    // Carve out a user stack for another thread running in this
+    // address space.  Return the stack slot, or -1 if there is no room.
+    int AllocateStack();
+
+    // Give back a stack slot.  Return true if no thread is left
+    // running in this address space.
+    bool ReleaseStack(int slot);
+
+    // Initialize user-level CPU registers for a thread that starts
+    // running the procedure at "func", on the stack in "slot"
+    void InitThreadRegisters(int func, int slot);
+
+    // Open files of the process.  All the threads running in this
+    // address space share them; a process created by Exec or Clone
+    // starts with none.  Files still open are closed with the space.
+    int AddFile(OpenFile* openFile);
+    OpenFile* GetFile(int fileDescriptor);
+    void RemoveFile(int fileDescriptor);
+
+    // Fill in "usage" with the memory this address space uses
+    void GetUsage(MemoryUsage* usage);
+
+    // Threads running in this address space
+    int NumThreads() { return MaxUserThreads - stackSlots->NumClear(); }
+
+    // Pages in the working set, as of the last sample
+    int WorkingSetSize() { return workingSetSize; }
+
     // Save/restore address space-specific info on a context switch
     void SaveState();
     void RestoreState();
 
+    #ifdef USE_TLB
+    // Copy the use and dirty bits of a TLB translation to the page table
+    void SaveTlbEntry(TranslationEntry* entry);
+
+    // Identifier tagging our translations in the TLB, valid while
+    // "asidGeneration" is the TLB manager's current generation
+    int asid;
+    int asidGeneration;
+    #endif
+
     int Translate(int virtualAddress);
 
     TranslationEntry* GetPage(int virtualPageNumber);
 
-    #ifdef DEMAND_PAGING
-    void LoadPage(int virtualPageNumber);
-    #endif
+    // Give "virtualPageNumber" a physical page holding its initial
+    // contents.  "prefetch" is true if it is loaded ahead of a fault.
+    void LoadPage(int virtualPageNumber, bool prefetch = false);
+
+    // Handle a write to the read-only page "virtualPageNumber".  Return
+    // false if it is not a copy-on-write page.
+    bool CopyOnWrite(int virtualPageNumber);
 
     #ifdef PAGING
-    void SwapIn(int virtualPage);
+    // Stop using the shared page "physicalPage", if it is mapped at
+    // "virtualPage"
+    void UnmapSharedPage(int virtualPage, int physicalPage);
+
+    void SwapIn(int virtualPage, bool prefetch = false);
     void SwapOut(int virtualPage);
-    int MakeRoom();
-    int Clock();
+
+    // A free physical page, evicting a page if there is none
+    static int AllocateFrame();
+
+    // Evict a page, and return the physical page it leaves free
+    static int MakeRoom();
+
+    // Choose a physical page to evict, with a clock over the core map
+    static int Clock();
     #endif
 
  private:
@@ -63,8 +131,52 @@ class AddrSpace {
     // Number of pages in the virtual address space
     unsigned int numPages;
 
-    OpenFile* executable;
-    NoffHeader noffH;
+    // Number of pages holding the program and the main thread's stack;
+    // the stacks of forked threads are laid out after them
+    unsigned int imagePages;
+
+    // Stack slots in use by the threads sharing this address space
+    BitMap* stackSlots;
+
+    // Files opened by the threads sharing this address space
+    std::map<int, OpenFile*> openFilesTable;
+
+    // Grow the page table to "newNumPages" entries
+    bool ExtendPageTable(unsigned int newNumPages);
+
+    // The program, shared with the other processes running it
+    ExecImage* image;
+
+    #ifdef USE_TLB
+    // TLB lookups and hits while this address space was running, and
+    // the global counts when it last started running
+    int tlbLookups, tlbHits;
+    int tlbLookupsAtRestore, tlbHitsAtRestore;
+    #endif
+
+    // User ticks run in this address space so far
+    int VirtualTime();
+
+    // Shift the use bits of the pages into their history, if a working
+    // set interval went by since the last sample
+    void SampleWorkingSet();
+
+    int runTicks;  // User ticks run, up to the last context switch
+    int userTicksAtRestore;  // Global user ticks when it last started
+    int lastSample;  // Virtual time of the last working set sample
+    int workingSetSize;
+    int pageFaults;
+
+    // Use bits of each page at the last WorkingSetSamples samples, the
+    // most recent one being the highest bit
+    unsigned char* useHistory;
+
+    // Is "virtualPage" made only of program code?
+    bool IsSharedCode(int virtualPage);
+
+    // Copy the part of "segment" that falls in "virtualPage" into
+    // memory, from the segment "contents"
+    void LoadSegment(int virtualPage, Segment* segment, char* contents);
 
     #ifdef DEMAND_PAGING
     // Table for keeping track of pages state when using demand paging
@@ -72,8 +184,25 @@ class AddrSpace {
     #endif
 
     #ifdef PAGING
-    char* swapName;
-    OpenFile* swap;
+    // Save physical page "physicalPage", holding "virtualPage", before
+    // it is evicted, writing it to the swap area if it was modified
+    void PageOut(int virtualPage, int physicalPage);
+
+    // Swap area slot keeping each virtual page, or -1 if it has none
+    int* swapSlots;
+
+    // Load up to "prefetchWindow" pages following "virtualPage" into
+    // free physical pages
+    void Prefetch(int virtualPage);
+
+    // Adapt the prefetch window to a fault on "virtualPage"
+    void AdaptPrefetchWindow(int virtualPage);
+
+    // "virtualPage", loaded ahead, is being evicted without being used
+    void PrefetchWasted(int virtualPage);
+
+    int lastFault;  // Virtual page of the last fault
+    int prefetchWindow;  // Pages to load ahead of the next fault
     #endif
 };
 
@@ -15,15 +15,19 @@
 //	it can be added somewhere on a list.
 //
 //	"nitems" is the number of bits in the bitmap.
+//	"nextFit" makes Find go on from the last bit it found.
 //----------------------------------------------------------------------
 
-BitMap::BitMap(int nitems) 
+BitMap::BitMap(int nitems, bool useNextFit) 
 { 
     numBits = nitems;
     numWords = divRoundUp(numBits, BitsInWord);
     map = new unsigned int[numWords];
-    for (int i = 0; i < numBits; i++) 
-        Clear(i);
+    for (int i = 0; i < numWords; i++) 
+        map[i] = 0;
+    numClear = numBits;
+    nextFit = useNextFit;
+    hint = 0;
 }
 
 //----------------------------------------------------------------------
@@ -47,7 +51,11 @@ void
 BitMap::Mark(int which) 
 { 
     ASSERT(which >= 0 && which < numBits);
-    map[which / BitsInWord] |= 1 << (which % BitsInWord);
+    unsigned int bit = 1u << (which % BitsInWord);
+    if (!(map[which / BitsInWord] & bit)) {
+	map[which / BitsInWord] |= bit;
+	numClear--;
+    }
 }
     
 //----------------------------------------------------------------------
@@ -61,7 +69,13 @@ void
 BitMap::Clear(int which) 
 {
     ASSERT(which >= 0 && which < numBits);
-    map[which / BitsInWord] &= ~(1 << (which % BitsInWord));
+    unsigned int bit = 1u << (which % BitsInWord);
+    if (map[which / BitsInWord] & bit) {
+	map[which / BitsInWord] &= ~bit;
+	numClear++;
+    }
+    if (!nextFit && which < hint)
+	hint = which;
 }
 
 //----------------------------------------------------------------------
@@ -82,40 +96,241 @@ BitMap::Test(int which)
 	return false;
 }
 
+//----------------------------------------------------------------------
+// BitMap::NextClear
+// 	Return the number of the first clear bit at or after "from", or
+//	-1 if there is none.  Whole words of set bits are skipped, and
+//	the first clear bit in a word is found by counting the trailing
+//	set bits.
+//----------------------------------------------------------------------
+
+int
+BitMap::NextClear(int from)
+{
+    int word = from / BitsInWord;
+    if (word >= numWords)
+	return -1;
+
+    // leave out the bits of the first word before "from"
+    unsigned int clear = ~map[word] & (~0u << (from % BitsInWord));
+    while (clear == 0) {
+	if (++word == numWords)
+	    return -1;
+	clear = ~map[word];
+    }
+
+    // the last word may have bits past the end of the bitmap
+    int which = word * BitsInWord + __builtin_ctz(clear);
+    return which < numBits ? which : -1;
+}
+
+//----------------------------------------------------------------------
+// BitMap::NextSet
+// 	Return the number of the first set bit at or after "from", or
+//	numBits if there is none.
+//----------------------------------------------------------------------
+
+int
+BitMap::NextSet(int from)
+{
+    int word = from / BitsInWord;
+    if (word >= numWords)
+	return numBits;
+
+    unsigned int set = map[word] & (~0u << (from % BitsInWord));
+    while (set == 0) {
+	if (++word == numWords)
+	    return numBits;
+	set = map[word];
+    }
+
+    int which = word * BitsInWord + __builtin_ctz(set);
+    return which < numBits ? which : numBits;
+}
+
 //----------------------------------------------------------------------
 // BitMap::Find
 // 	Return the number of the first bit which is clear.
 //	As a side effect, set the bit (mark it as in use).
 //	(In other words, find and allocate a bit.)
 //
+//	With next-fit, the search starts after the bit found last time,
+//	and wraps around to the beginning of the bitmap.
+//
 //	If no bits are clear, return -1.
 //----------------------------------------------------------------------
 
 int 
 BitMap::Find() 
 {
-    for (int i = 0; i < numBits; i++)
-	if (!Test(i)) {
-	    Mark(i);
-	    return i;
+    if (numClear == 0)
+	return -1;
+
+    int which = NextClear(hint);
+    if (which == -1)
+	which = NextClear(0);
+    ASSERT(which != -1);
+
+    Mark(which);
+    hint = which + 1;
+    return which;
+}
+
+//----------------------------------------------------------------------
+// BitMap::FindRunIn
+// 	Return the number of the first bit of "count" consecutive clear
+//	bits, the first of which lies in [from, to), or -1 if there are
+//	none.
+//----------------------------------------------------------------------
+
+int
+BitMap::FindRunIn(int from, int to, int count)
+{
+    int start = NextClear(from);
+    while (start != -1 && start < to) {
+	int end = NextSet(start);
+	if (end - start >= count)
+	    return start;
+	start = NextClear(end);
+    }
+    return -1;
+}
+
+//----------------------------------------------------------------------
+// BitMap::FindRun
+// 	Return the number of the first of "count" consecutive clear
+//	bits, and set them all.  With next-fit, the search starts where
+//	the last one stopped, as in Find.
+//
+//	If there are not that many consecutive clear bits, return -1.
+//----------------------------------------------------------------------
+
+int
+BitMap::FindRun(int count)
+{
+    ASSERT(count > 0);
+    if (count > numClear)
+	return -1;
+
+    int start = FindRunIn(hint, numBits, count);
+    if (start == -1 && nextFit)
+	start = FindRunIn(0, hint, count);
+    if (start == -1)
+	return -1;
+
+    for (int i = start; i < start + count; i++)
+	Mark(i);
+    if (nextFit)
+	hint = start + count;
+    return start;
+}
+
+//----------------------------------------------------------------------
+// BitMap::FindRunAligned
+// 	Return the number of the first of "count" consecutive clear bits
+//	that lie between two multiples of "align", or, if "count" is more
+//	than "align", that start on a multiple of it; and set them all.
+//	For disk sectors, with "align" the sectors in a track, this finds
+//	runs that take as few tracks as possible.
+//
+//	If there is no such run, return -1.
+//----------------------------------------------------------------------
+
+int
+BitMap::FindRunAligned(int count, int align)
+{
+    ASSERT(count > 0 && align > 0);
+    if (count > numClear)
+	return -1;
+
+    int start = NextClear(nextFit ? 0 : hint);
+    while (start != -1) {
+	int end = NextSet(start);
+	int first = start;
+	if (count > align || first % align + count > align)
+	    first = divRoundUp(first, align) * align;
+	if (first + count <= end) {
+	    for (int i = first; i < first + count; i++)
+		Mark(i);
+	    return first;
 	}
+	start = NextClear(end);
+    }
     return -1;
 }
 
+//----------------------------------------------------------------------
+// BitMap::FindLargestRun
+// 	Return the number of the first bit of the first run of at least
+//	"maxCount" clear bits, or, if there is none, of the longest run
+//	there is.  Set the first "maxCount" bits of the run, or all of it
+//	if it is shorter, and return how many in "*count".
+//
+//	If no bits are clear, return -1.
+//----------------------------------------------------------------------
+
+int
+BitMap::FindLargestRun(int maxCount, int *count)
+{
+    int best = -1, bestLength = 0;
+
+    ASSERT(maxCount > 0);
+    int start = NextClear(nextFit ? 0 : hint);
+    while (start != -1 && bestLength < maxCount) {
+	int end = NextSet(start);
+	if (end - start > bestLength) {
+	    best = start;
+	    bestLength = end - start;
+	}
+	start = NextClear(end);
+    }
+    if (best == -1)
+	return -1;
+
+    if (bestLength > maxCount)
+	bestLength = maxCount;
+    for (int i = best; i < best + bestLength; i++)
+	Mark(i);
+    *count = bestLength;
+    return best;
+}
+
+//----------------------------------------------------------------------
+// BitMap::NumClearRuns
+// 	Return the number of runs of consecutive clear bits, and the
+//	length of the longest of them in "*largest".  The more runs the
+//	clear bits are split into, the more fragmented the free space is.
+//----------------------------------------------------------------------
+
+int
+BitMap::NumClearRuns(int *largest)
+{
+    int runs = 0;
+
+    *largest = 0;
+    int start = NextClear(0);
+    while (start != -1) {
+	int end = NextSet(start);
+	runs++;
+	if (end - start > *largest)
+	    *largest = end - start;
+	start = NextClear(end);
+    }
+    return runs;
+}
+
 //----------------------------------------------------------------------
 // BitMap::NumClear
 // 	Return the number of clear bits in the bitmap.
 //	(In other words, how many bits are unallocated?)
+//
+//	The count is kept up to date by Mark and Clear.
 //----------------------------------------------------------------------
 
 int 
 BitMap::NumClear() 
 {
-    int count = 0;
-
-    for (int i = 0; i < numBits; i++)
-	if (!Test(i)) count++;
-    return count;
+    return numClear;
 }
 
 //----------------------------------------------------------------------
@@ -149,6 +364,14 @@ void
 BitMap::FetchFrom(OpenFile *file) 
 {
     file->ReadAt((char *)map, numWords * sizeof(unsigned), 0);
+
+    numClear = 0;
+    for (int i = 0; i < numWords; i++) {
+	int bits = i < numWords - 1 ? BitsInWord : numBits - i * BitsInWord;
+	unsigned int mask = bits == BitsInWord ? ~0u : (1u << bits) - 1;
+	numClear += bits - __builtin_popcount(map[i] & mask);
+    }
+    hint = 0;
 }
 
 //----------------------------------------------------------------------
@@ -8,6 +8,10 @@
 //	The bitmap can be parameterized with with the number of bits being 
 //	managed.
 //
+//	Searches go a word at a time, skipping words with no clear bits,
+//	and start from a hint rather than from bit 0 every time.  The
+//	number of clear bits is kept up to date as bits change.
+//
 // Copyright (c) 1992-1993 The Regents of the University of California.
 // All rights reserved.  See copyright.h for copyright notice and limitation 
 // of liability and disclaimer of warranty provisions.
@@ -33,8 +37,12 @@
 
 class BitMap {
   public:
-    BitMap(int nitems);		// Initialize a bitmap, with "nitems" bits
+    BitMap(int nitems, bool nextFit = false);
+				// Initialize a bitmap, with "nitems" bits
 				// initially, all bits are cleared.
+				// With "nextFit", Find goes on from the
+				// last bit it found instead of returning
+				// the lowest clear bit.
     ~BitMap();			// De-allocate bitmap
     
     void Mark(int which);   	// Set the "nth" bit
@@ -43,6 +51,24 @@ class BitMap {
     int Find();            	// Return the # of a clear bit, and as a side
 				// effect, set the bit. 
 				// If no bits are clear, return -1.
+    int FindRun(int count);	// Return the # of the first of "count"
+				// consecutive clear bits, and set them.
+				// If there are none, return -1.
+    int FindRunAligned(int count, int align);
+				// The same, but the run must not cross
+				// a multiple of "align" if it can fit
+				// between two, and must start on one
+				// otherwise
+    int FindLargestRun(int maxCount, int *count);
+				// Return the # of the first bit of the
+				// longest run of clear bits, cut down to
+				// "maxCount" bits, and set them.  The
+				// length goes in "*count".  If no bits
+				// are clear, return -1.
+    int NumClearRuns(int *largest);
+				// Return the number of runs of
+				// consecutive clear bits, and the length
+				// of the longest in "*largest"
     int NumClear();		// Return the number of clear bits
 
     void Print();		// Print contents of bitmap
@@ -59,6 +85,19 @@ class BitMap {
 					//  multiple of the number of bits in
 					//  a word)
     unsigned int *map;			// bit storage
+    int numClear;			// number of clear bits
+    bool nextFit;			// Find goes on from the last bit found
+    int hint;				// where searches start: with next-fit,
+					// past the last bit found; otherwise,
+					// no bit below it is clear
+
+    int NextClear(int from);		// # of the first clear bit at or
+					// after "from", or -1
+    int NextSet(int from);		// # of the first set bit at or after
+					// "from", or numBits
+    int FindRunIn(int from, int to, int count);
+					// first of "count" clear bits, the
+					// first of them in [from, to), or -1
 };
 
 #endif // BITMAP_H
@@ -0,0 +1,138 @@
+// bitmaptest.cc
+//	Microbenchmark for the bitmap, which keeps track of free physical
+//	pages, swap slots and disk sectors.
+//
+//	Times Find, FindRun and NumClear on a bitmap of a million bits,
+//	against the bit at a time loops Find and NumClear used to be.
+
+#include "copyright.h"
+#include "system.h"
+#include "bitmap.h"
+
+#include <time.h>
+
+#define TestBits	(1 << 20)
+#define TestHoles	1000	// bits cleared in a full bitmap
+#define TestRunLength	16
+
+static double
+Seconds()
+{
+    return (double) clock() / CLOCKS_PER_SEC;
+}
+
+// What Find and NumClear used to do
+static int
+SlowFind(BitMap *map)
+{
+    for (int i = 0; i < TestBits; i++)
+	if (!map->Test(i)) {
+	    map->Mark(i);
+	    return i;
+	}
+    return -1;
+}
+
+static int
+SlowNumClear(BitMap *map)
+{
+    int count = 0;
+
+    for (int i = 0; i < TestBits; i++)
+	if (!map->Test(i)) count++;
+    return count;
+}
+
+// Clear "count" random bits of "map", and return how many were set
+static int
+MakeHoles(BitMap *map, int count)
+{
+    int cleared = 0;
+
+    for (int i = 0; i < count; i++) {
+	int which = Random() % TestBits;
+	if (map->Test(which)) {
+	    map->Clear(which);
+	    cleared++;
+	}
+    }
+    return cleared;
+}
+
+static void
+Report(const char *what, int operations, double start)
+{
+    double elapsed = Seconds() - start;
+    printf("%s: %d in %.3f s, %.3f us each\n", what, operations, elapsed,
+	elapsed * 1e6 / operations);
+}
+
+//----------------------------------------------------------------------
+// BitMapTest
+// 	Fill a bitmap of TestBits bits, punch random holes in it, and time
+//	how long it takes to find them again, one by one and in runs.
+//----------------------------------------------------------------------
+
+void
+BitMapTest()
+{
+    BitMap *map = new BitMap(TestBits);
+    double start;
+    int i, holes, found;
+
+    printf("Bitmap test, %d bits\n", TestBits);
+
+    start = Seconds();
+    for (i = 0; i < TestBits; i++)
+	ASSERT(map->Find() == i);
+    Report("Find, filling the bitmap", TestBits, start);
+
+    holes = MakeHoles(map, TestHoles);
+    start = Seconds();
+    for (i = 0; i < holes; i++)
+	ASSERT(map->Find() != -1);
+    Report("Find, random holes", holes, start);
+    ASSERT(map->Find() == -1);
+
+    // the old loop scans half the bitmap per hole; a tenth of them do
+    holes = MakeHoles(map, TestHoles / 10);
+    start = Seconds();
+    for (i = 0; i < holes; i++)
+	ASSERT(SlowFind(map) != -1);
+    Report("Bit at a time Find, random holes", holes, start);
+
+    holes = MakeHoles(map, TestHoles);
+    start = Seconds();
+    for (i = 0; i < TestHoles; i++)
+	ASSERT(map->NumClear() == holes);
+    Report("NumClear", TestHoles, start);
+
+    start = Seconds();
+    for (i = 0; i < 10; i++)
+	ASSERT(SlowNumClear(map) == holes);
+    Report("Bit at a time NumClear", 10, start);
+
+    // runs of holes, among the single ones
+    for (i = 0; i < TestHoles / 10; i++) {
+	int first = Random() % (TestBits - TestRunLength);
+	for (int j = first; j < first + TestRunLength; j++)
+	    map->Clear(j);
+    }
+    start = Seconds();
+    for (found = 0; map->FindRun(TestRunLength) != -1; found++)
+	;
+    Report("FindRun", found + 1, start);
+    printf("Runs of %d bits found: %d\n", TestRunLength, found);
+    delete map;
+
+    // next-fit goes round the bitmap instead of going back to the start
+    map = new BitMap(TestBits, true);
+    for (i = 0; i < TestBits; i++)
+	map->Mark(i);
+    holes = MakeHoles(map, TestHoles);
+    start = Seconds();
+    for (i = 0; i < holes; i++)
+	ASSERT(map->Find() != -1);
+    Report("Next-fit Find, random holes", holes, start);
+    delete map;
+}
@@ -50,26 +50,36 @@ void readBuffFromUsr(int userAddress, char *outBuffer, int byteCount) {
     outBuffer[byteCount] = 0;
 }
 
+// A write may fault twice before it succeeds: once to bring the page
+// into the TLB, and once more to copy it if it is copy-on-write.
+// CopyOnWrite puts the copy in the TLB entry itself, so the write does
+// not miss again after that.
+void writeByteToUsr(int userAddress, char value) {
+    for (int tries = 0; !machine->WriteMem(userAddress, 1, value); tries++) {
+        ASSERT(tries < 2);
+    }
+}
+
+void writeIntToUsr(int userAddress, int value) {
+    for (int tries = 0; !machine->WriteMem(userAddress, 4, value); tries++) {
+        ASSERT(tries < 2);
+    }
+}
+
 void writeStrToUsr(char *str, int userAddress) {
     int i = 0;
 
     do {
-        if (!machine->WriteMem(userAddress + i, 1, str[i])) {
-            ASSERT(machine->WriteMem(userAddress + i, 1, str[i]));
-        }
+        writeByteToUsr(userAddress + i, str[i]);
     } while (str[i++]);
 }
 
 void writeBuffToUsr(char *str, int userAddress, int byteCount) {
     for (int i = 0; i < byteCount; i++) {
-        if (!machine->WriteMem(userAddress + i, 1, str[i])) {
-            ASSERT(machine->WriteMem(userAddress + i, 1, str[i]));
-        }
+        writeByteToUsr(userAddress + i, str[i]);
     }
 
-    if (!machine->WriteMem(userAddress + byteCount, 1, 0)) {
-        ASSERT(machine->WriteMem(userAddress + byteCount, 1, 0));
-    }
+    writeByteToUsr(userAddress + byteCount, 0);
 }
 
 void IncrementProgramCounter() {
@@ -82,24 +92,29 @@ void IncrementProgramCounter() {
 
 void PrepareProcess(void* arg) {
     char* filename = reinterpret_cast<char*>(arg);
-    OpenFile* executable = fileSystem->Open(reinterpret_cast<char*>(filename));
-    if (executable == NULL) {
+    ExecImage* image = imageCache->Get(filename);
+    if (image == NULL) {
         DEBUG('c', "Could not open file %s\n", filename);
         machine->WriteRegister(2, -1);
         delete[] filename;
         return;
     }
     delete[] filename;
-    AddrSpace* addressSpace = new AddrSpace(executable);
-    #ifndef DEMAND_PAGING
-    delete executable;
-    #endif
+    AddrSpace* addressSpace = new AddrSpace(image);
     currentThread->space = addressSpace;
     currentThread->space->InitRegisters();
     currentThread->space->RestoreState();
     machine->Run();
 }
 
+void StartUserThread(void* arg) {
+    int funcAddress = static_cast<int>(reinterpret_cast<HostMemoryAddress>(arg));
+    currentThread->space->InitThreadRegisters(funcAddress,
+        currentThread->userStackSlot);
+    currentThread->space->RestoreState();
+    machine->Run();
+}
+
 //----------------------------------------------------------------------
 // ExceptionHandler
 //  Entry point into the Nachos kernel.  Called when a user program
@@ -125,6 +140,9 @@ void PrepareProcess(void* arg) {
 
 void Halt() {
     DEBUG('a', "Shutdown, initiated by user program.\n");
+    #ifdef FILESYS
+    fileSystem->Sync();  // before the statistics are printed
+    #endif
     interrupt->Halt();
 }
 
@@ -133,6 +151,7 @@ void Create() {
     int fileSize = 0;
     char* filename = new char[128];
     readStrFromUsr(filenameAddr, filename);
+    imageCache->Invalidate(filename);
 
     if (fileSystem->Create(filename, fileSize)) {
         DEBUG('c', "File '%s' created successfully.\n", filename);
@@ -160,7 +179,7 @@ void Read() {
             }
             break;
         default:
-            OpenFile* openFile = currentThread->GetFile(fileDescriptor);
+            OpenFile* openFile = currentThread->space->GetFile(fileDescriptor);
             bytesReadCount = openFile->Read(buffer, size);
             break;
     }
@@ -187,7 +206,7 @@ void Write() {
             }
             break;
         default:
-            OpenFile* openFile = currentThread->GetFile(fileDescriptor);
+            OpenFile* openFile = currentThread->space->GetFile(fileDescriptor);
             openFile->Write(buffer, size);
             break;
     }
@@ -197,13 +216,15 @@ void Open() {
     int filenameAddress = machine->ReadRegister(4);
     char* filename = new char[128];
     readStrFromUsr(filenameAddress, filename);
+    // the program may be about to write to an executable
+    imageCache->Invalidate(filename);
     OpenFile* openFile = fileSystem->Open(filename);
     delete[] filename;
     if (!openFile) {
         DEBUG('c', "Could not open file: %s\n", filename);
         machine->WriteRegister(2, -1);
     } else {
-        OpenFileId fileDescriptor = currentThread->AddFile(openFile);
+        OpenFileId fileDescriptor = currentThread->space->AddFile(openFile);
         machine->WriteRegister(2, fileDescriptor);
         DEBUG('c', "Opened file: %d\n", fileDescriptor);
     }
@@ -211,12 +232,15 @@ void Open() {
 
 void Close() {
     OpenFileId fileDescriptor = machine->ReadRegister(4);
-    currentThread->RemoveFile(fileDescriptor);
+    currentThread->space->RemoveFile(fileDescriptor);
 }
 
 void Exit() {
     int exitStatus = machine->ReadRegister(4);
     currentThread->setExitStatus(exitStatus);
+    #ifdef PAGING
+    loadControl->SetWaiting(currentThread->space, true);
+    #endif
     currentThread->Finish();
 }
 
@@ -225,7 +249,14 @@ void Join() {
     Thread* thread = processTable->GetProcess(pid);
     if (thread) {
         machine->WriteRegister(2, thread->getExitStatus());
+        #ifdef PAGING
+        // a suspended child must not wait for its parent to run
+        loadControl->SetWaiting(currentThread->space, true);
+        #endif
         thread->Join();
+        #ifdef PAGING
+        loadControl->SetWaiting(currentThread->space, false);
+        #endif
     } else {
         DEBUG('c', "Could not find process with id %d\n", pid);
         machine->WriteRegister(2, -1);
@@ -271,6 +302,78 @@ void Exec() {
     delete[] argv;
 }
 
+void Fork() {
+    int funcAddress = machine->ReadRegister(4);
+    AddrSpace* space = currentThread->space;
+
+    int slot = space->AllocateStack();
+    if (slot == -1) {
+        DEBUG('c', "Could not allocate a user stack\n");
+        machine->WriteRegister(2, -1);
+        return;
+    }
+
+    Thread* thread = new Thread("user thread", true);
+    SpaceId pid = processTable->GetPID(thread);
+    if (pid == -1) {
+        DEBUG('c', "Process table is full\n");
+        delete thread;
+        space->ReleaseStack(slot);
+        machine->WriteRegister(2, -1);
+        return;
+    }
+    thread->space = space;
+    thread->userStackSlot = slot;
+
+    // the new thread sees the same arguments as its parent
+    userProgramArgs[pid] = userProgramArgs[processTable->GetPID(currentThread)];
+
+    machine->WriteRegister(2, pid);
+
+    thread->Fork(StartUserThread,
+        reinterpret_cast<void*>(static_cast<HostMemoryAddress>(funcAddress)));
+}
+
+void Yield() {
+    currentThread->Yield();
+}
+
+void StartClone(void* arg) {
+    currentThread->RestoreUserState();
+    machine->WriteRegister(2, 0);
+    IncrementProgramCounter();
+    currentThread->space->RestoreState();
+    machine->Run();
+}
+
+void CloneProcess() {
+    AddrSpace* space = currentThread->space;
+    Thread* thread = new Thread("clone", true);
+    SpaceId pid = processTable->GetPID(thread);
+    if (pid == -1) {
+        DEBUG('c', "Process table is full\n");
+        delete thread;
+        machine->WriteRegister(2, -1);
+        return;
+    }
+
+    #ifdef USE_TLB
+    // dirty bits must reach the page table before pages are shared,
+    // and writable translations of them must go
+    tlbManager->Flush(space);
+    #endif
+    thread->space = new AddrSpace(space, pid);
+    thread->userStackSlot = currentThread->userStackSlot;
+
+    userProgramArgs[pid] = userProgramArgs[processTable->GetPID(currentThread)];
+
+    // the new process resumes from this same system call
+    thread->SaveUserState();
+    machine->WriteRegister(2, pid);
+
+    thread->Fork(StartClone, NULL);
+}
+
 void GetArgN() {
     int argIndex = machine->ReadRegister(4);
     int argAddress = machine->ReadRegister(5);
@@ -288,6 +391,43 @@ void GetNArgs() {
     machine->WriteMem(nAddress, 4, args.size());
 }
 
+void GetMemoryUsage() {
+    SpaceId pid = machine->ReadRegister(4);
+    int usageAddress = machine->ReadRegister(5);
+    Thread* thread = pid == -1 ? currentThread : processTable->GetProcess(pid);
+    if (thread == NULL || thread->space == NULL) {
+        DEBUG('c', "Could not find process with id %d\n", pid);
+        machine->WriteRegister(2, -1);
+        return;
+    }
+
+    MemoryUsage usage;
+    thread->space->GetUsage(&usage);
+    writeIntToUsr(usageAddress, usage.residentPages);
+    writeIntToUsr(usageAddress + 4, usage.workingSet);
+    writeIntToUsr(usageAddress + 8, usage.pageFaults);
+    writeIntToUsr(usageAddress + 12, usage.runTicks);
+    machine->WriteRegister(2, 0);
+}
+
+void Preallocate() {
+    int size = machine->ReadRegister(4);
+    OpenFileId fileDescriptor = machine->ReadRegister(5);
+    OpenFile* openFile = NULL;
+    if (fileDescriptor > ConsoleOutput &&
+        fileDescriptor < MAX_OPEN_FILES_TABLE_SIZE) {
+        openFile = currentThread->space->GetFile(fileDescriptor);
+    }
+    if (openFile == NULL || size < 0) {
+        DEBUG('c', "Could not preallocate %d bytes for file %d\n",
+              size, fileDescriptor);
+        machine->WriteRegister(2, -1);
+        return;
+    }
+
+    machine->WriteRegister(2, openFile->Reserve(size) ? 0 : -1);
+}
+
 void
 ExceptionHandler(ExceptionType which) {
     int type = machine->ReadRegister(2);
@@ -321,12 +461,27 @@ ExceptionHandler(ExceptionType which) {
             case SC_Exec:
                 Exec();
                 break;
+            case SC_Fork:
+                Fork();
+                break;
+            case SC_Yield:
+                Yield();
+                break;
             case SC_GetArgN:
                 GetArgN();
                 break;
             case SC_GetNArgs:
                 GetNArgs();
                 break;
+            case SC_Clone:
+                CloneProcess();
+                break;
+            case SC_GetMemoryUsage:
+                GetMemoryUsage();
+                break;
+            case SC_Preallocate:
+                Preallocate();
+                break;
             default:
                 printf("Unexpected user mode exception %d %d\n", which, type);
                 ASSERT(false);
@@ -336,29 +491,32 @@ ExceptionHandler(ExceptionType which) {
     } else if (which == PageFaultException) {
         int badVirtualAddress = machine->ReadRegister(BadVAddrReg);
         int virtualPageNumber = badVirtualAddress / PageSize;
-        int i;
 
+        #ifdef PAGING
+        loadControl->Admit(currentThread->space);
+        pagingLock->Acquire();
+        #endif
         TranslationEntry* entry =
             currentThread->space->GetPage(virtualPageNumber);
-
-        for (i = 0; i < TLBSize; i++) {
-            if (!machine->tlb[i].valid) {
-                break;
-            }
-        }
-
-        if (i == TLBSize) {
-            i = rand() % TLBSize;
-        }
-
-        machine->tlb[i].virtualPage = entry->virtualPage;
-        machine->tlb[i].physicalPage = entry->physicalPage;
-        machine->tlb[i].valid = true;
-        machine->tlb[i].use = entry->use;
-        machine->tlb[i].dirty = entry->dirty;
-        machine->tlb[i].readOnly = entry->readOnly;
+        #ifdef USE_TLB
+        tlbManager->Refill(entry);
+        #else
+        ASSERT(entry->valid);
+        #endif
+        #ifdef PAGING
+        pagingLock->Release();
+        #endif
     } else if (which == ReadOnlyException) {
-        ASSERT(false);
+        int badVirtualAddress = machine->ReadRegister(BadVAddrReg);
+        #ifdef PAGING
+        pagingLock->Acquire();
+        #endif
+        bool copied =
+            currentThread->space->CopyOnWrite(badVirtualAddress / PageSize);
+        ASSERT(copied);  // writing to code is still fatal
+        #ifdef PAGING
+        pagingLock->Release();
+        #endif
     } else {
         printf("Unexpected user mode exception %d %d\n", which, type);
         ASSERT(false);
@@ -0,0 +1,144 @@
+// imagecache.cc
+//  Routines to cache parsed executables.
+
+#include "system.h"
+#include "imagecache.h"
+
+//----------------------------------------------------------------------
+// SwapHeader
+//  Do little endian to big endian conversion on the bytes in the
+//  object file header, in case the file was generated on a little
+//  endian machine, and we're now running on a big endian machine.
+//----------------------------------------------------------------------
+
+static void
+SwapHeader(NoffHeader *noffH) {
+    noffH->noffMagic = WordToHost(noffH->noffMagic);
+    noffH->code.size = WordToHost(noffH->code.size);
+    noffH->code.virtualAddr = WordToHost(noffH->code.virtualAddr);
+    noffH->code.inFileAddr = WordToHost(noffH->code.inFileAddr);
+    noffH->initData.size = WordToHost(noffH->initData.size);
+    noffH->initData.virtualAddr = WordToHost(noffH->initData.virtualAddr);
+    noffH->initData.inFileAddr = WordToHost(noffH->initData.inFileAddr);
+    noffH->uninitData.size = WordToHost(noffH->uninitData.size);
+    noffH->uninitData.virtualAddr = WordToHost(noffH->uninitData.virtualAddr);
+    noffH->uninitData.inFileAddr = WordToHost(noffH->uninitData.inFileAddr);
+}
+
+//----------------------------------------------------------------------
+// ExecImage::ExecImage
+//  Read the header, code and initialized data of a program.
+//
+//  Assumes that the object code file is in NOFF format.
+//----------------------------------------------------------------------
+
+ExecImage::ExecImage(const char* programName, OpenFile* file) {
+    name = new char[strlen(programName) + 1];
+    strcpy(name, programName);
+
+    file->ReadAt(reinterpret_cast<char *>(&noffH), sizeof(noffH), 0);
+    if ((noffH.noffMagic != NOFFMAGIC) &&
+        (WordToHost(noffH.noffMagic) == NOFFMAGIC))
+        SwapHeader(&noffH);
+    ASSERT(noffH.noffMagic == NOFFMAGIC);
+
+    code = new char[noffH.code.size];
+    file->ReadAt(code, noffH.code.size, noffH.code.inFileAddr);
+    initData = new char[noffH.initData.size];
+    file->ReadAt(initData, noffH.initData.size, noffH.initData.inFileAddr);
+
+    refCount = 0;
+    cached = false;
+    lastUsed = 0;
+}
+
+ExecImage::~ExecImage() {
+    delete[] name;
+    delete[] code;
+    delete[] initData;
+}
+
+ImageCache::ImageCache() {
+    images = new ExecImage*[MaxCachedImages];
+    for (int i = 0; i < MaxCachedImages; i++) {
+        images[i] = NULL;
+    }
+    clock = 0;
+}
+
+ImageCache::~ImageCache() {
+    for (int i = 0; i < MaxCachedImages; i++) {
+        if (images[i] != NULL && images[i]->refCount == 0) {
+            delete images[i];
+        }
+    }
+    delete[] images;
+}
+
+//----------------------------------------------------------------------
+// ImageCache::Get
+//  Look up the executable "name", reading it from the file system on a
+//  miss.  The new image replaces the least recently used one that no
+//  address space is using; if they are all in use, it is not cached,
+//  and goes away with the last address space using it.
+//----------------------------------------------------------------------
+
+ExecImage* ImageCache::Get(const char* name) {
+    int empty = -1, leastRecent = -1;
+
+    clock++;
+    for (int i = 0; i < MaxCachedImages; i++) {
+        if (images[i] == NULL) {
+            if (empty == -1)
+                empty = i;
+        } else if (strcmp(images[i]->name, name) == 0) {
+            DEBUG('a', "Executable %s found in the image cache\n", name);
+            images[i]->lastUsed = clock;
+            images[i]->refCount++;
+            return images[i];
+        } else if (images[i]->refCount == 0 && (leastRecent == -1 ||
+                   images[i]->lastUsed < images[leastRecent]->lastUsed)) {
+            leastRecent = i;
+        }
+    }
+
+    OpenFile* file = fileSystem->Open(name);
+    if (file == NULL)
+        return NULL;
+    ExecImage* image = new ExecImage(name, file);
+    delete file;
+    DEBUG('a', "Executable %s read into the image cache\n", name);
+
+    image->refCount = 1;
+    image->lastUsed = clock;
+    int victim = (empty != -1) ? empty : leastRecent;
+    if (victim != -1) {
+        delete images[victim];
+        images[victim] = image;
+        image->cached = true;
+    }
+    return image;
+}
+
+void ImageCache::Hold(ExecImage* image) {
+    image->refCount++;
+}
+
+void ImageCache::Release(ExecImage* image) {
+    ASSERT(image->refCount > 0);
+    image->refCount--;
+    if (image->refCount == 0 && !image->cached)
+        delete image;
+}
+
+void ImageCache::Invalidate(const char* name) {
+    for (int i = 0; i < MaxCachedImages; i++) {
+        if (images[i] != NULL && strcmp(images[i]->name, name) == 0) {
+            DEBUG('a', "Dropping executable %s from the image cache\n", name);
+            images[i]->cached = false;
+            if (images[i]->refCount == 0)
+                delete images[i];
+            images[i] = NULL;
+        }
+    }
+}
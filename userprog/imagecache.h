@@ -0,0 +1,60 @@
+// imagecache.h
+//  Data structures to keep the executables of recently run programs
+//  in kernel memory.
+//
+//  Loading a program means opening its file, reading and checking the
+//  NOFF header, and reading code and data as pages are needed.  A
+//  program run over and over -- by the shell, for instance -- is read
+//  from its file only the first time; later address spaces copy their
+//  pages from the cached image.
+
+#ifndef USERPROG_IMAGECACHE_H_
+#define USERPROG_IMAGECACHE_H_
+
+#include "filesys.h"
+#include "noff.h"
+
+#define MaxCachedImages 8  // Executables kept around when not in use
+
+// The parsed contents of an executable file.
+class ExecImage {
+ public:
+    // Read the executable "file", called "name"
+    ExecImage(const char* name, OpenFile* file);
+    ~ExecImage();
+
+    char* name;
+    NoffHeader noffH;
+    char* code;  // Contents of the code segment
+    char* initData;  // Contents of the initialized data segment
+
+    int refCount;  // Address spaces using this image
+    bool cached;  // Can it still be found by name in the image cache?
+    int lastUsed;  // When it was last looked up, to pick what to evict
+};
+
+class ImageCache {
+ public:
+    ImageCache();
+    ~ImageCache();
+
+    // Return the image of executable "name", loading it if it is not
+    // cached, or NULL if there is no such file.  The caller must give
+    // it back with Release.
+    ExecImage* Get(const char* name);
+
+    // Count one more user of "image"
+    void Hold(ExecImage* image);
+
+    // Drop one user of "image"
+    void Release(ExecImage* image);
+
+    // The file "name" may have changed; stop handing out its image
+    void Invalidate(const char* name);
+
+ private:
+    ExecImage** images;
+    int clock;  // Number of lookups so far
+};
+
+#endif  // USERPROG_IMAGECACHE_H_
@@ -41,5 +41,7 @@ SpaceId ProcessTable::GetPID(Thread* thread) {
 }
 
 void ProcessTable::RemoveProcess(SpaceId pid) {
-    table[pid] = NULL;
+    if (pid >= 0 && pid < MAX_NUM_PROCESSES) {
+        table[pid] = NULL;
+    }
 }
@@ -22,20 +22,16 @@
 
 void
 StartProcess(const char *filename) {
-    OpenFile *executable = fileSystem->Open(filename);
+    ExecImage *image = imageCache->Get(filename);
     AddrSpace *space;
 
-    if (executable == NULL) {
+    if (image == NULL) {
         printf("Unable to open file %s\n", filename);
         return;
     }
-    space = new AddrSpace(executable);
+    space = new AddrSpace(image);
     currentThread->space = space;
 
-    #ifndef DEMAND_PAGING
-    delete executable;          // close file
-    #endif
-
     space->InitRegisters();     // set the initial register values
     space->RestoreState();      // load page table register
 
@@ -31,6 +31,9 @@
 #define SC_Yield	10
 #define SC_GetArgN  11
 #define SC_GetNArgs 12
+#define SC_Clone    13
+#define SC_GetMemoryUsage 14
+#define SC_Preallocate 15
 
 #ifndef IN_ASM
 
@@ -65,6 +68,27 @@ SpaceId Exec(char *name, char* argv);
  * Return the exit status.
  */
 int Join(SpaceId id); 	
+
+/* Create a new process running a copy of this one, like UNIX fork.
+ * Memory is copied lazily, as either process writes to it.  Return 0 in
+ * the new process, and its identifier (to be passed to Join) in the
+ * caller, or -1 if it could not be created.  Only the calling thread
+ * is copied, and the new process starts with no open files.
+ */
+SpaceId Clone();
+
+/* The memory used by a process, as filled in by GetMemoryUsage */
+typedef struct {
+    int residentPages;	/* pages in physical memory, shared ones included */
+    int workingSet;	/* pages used in the recent past */
+    int pageFaults;	/* page faults so far */
+    int runTicks;	/* user instructions run so far */
+} MemoryUsage;
+
+/* Fill in "usage" for the process "id", or for the calling process if 
+ * "id" is -1.  Return 0, or -1 if there is no such process.
+ */
+int GetMemoryUsage(SpaceId id, MemoryUsage* usage);
  
 
 /* File system operations: Create, Open, Read, Write, Close
@@ -110,6 +134,13 @@ int Read(char *buffer, int size, OpenFileId id);
 /* Close the file, we're done reading and writing to it. */
 void Close(OpenFileId id);
 
+/* Allocate the space for the open file to grow to "size" bytes, so that
+ * writing it does not need to.  The file keeps its length; writes past
+ * the end still make it grow.  Return 0, or -1 if "id" is not an open
+ * file or there is not enough free space.
+ */
+int Preallocate(int size, OpenFileId id);
+
 
 
 /* User-level thread operations: Fork and Yield.  To allow multiple
@@ -117,9 +148,11 @@ void Close(OpenFileId id);
  */
 
 /* Fork a thread to run a procedure ("func") in the *same* address space 
- * as the current thread.
+ * as the current thread, on a stack of its own.  Return an identifier
+ * that can be passed to Join, or -1 if no more threads fit in the
+ * address space.  "func" must finish by calling Exit.
  */
-void Fork(void (*func)());
+SpaceId Fork(void (*func)());
 
 /* Yield the CPU to another runnable thread, whether in this address space 
  * or not. 
@@ -0,0 +1,152 @@
+// textcache.cc
+//  Routines to share code pages between processes running the same
+//  executable.
+
+#include "system.h"
+#include "addrspace.h"
+#include "textcache.h"
+
+TextCache::TextCache() {
+    images = new ExecImage*[NumPhysPages];
+    virtualPages = new int[NumPhysPages];
+    hashNext = new int[NumPhysPages];
+    hashBuckets = new int[NumPhysPages];
+    for (int i = 0; i < NumPhysPages; i++) {
+        images[i] = NULL;
+        virtualPages[i] = -1;
+        hashNext[i] = -1;
+        hashBuckets[i] = -1;
+    }
+
+    #ifdef PAGING
+    spaces = new AddrSpace*[MaxSharingSpaces];
+    for (int i = 0; i < MaxSharingSpaces; i++) {
+        spaces[i] = NULL;
+    }
+    #endif
+}
+
+TextCache::~TextCache() {
+    delete[] images;
+    delete[] virtualPages;
+    delete[] hashNext;
+    delete[] hashBuckets;
+
+    #ifdef PAGING
+    delete[] spaces;
+    #endif
+}
+
+int TextCache::Hash(ExecImage* image, int virtualPage) {
+    unsigned int hash = reinterpret_cast<HostMemoryAddress>(image) /
+        sizeof(ExecImage);
+    hash = hash * 31 + virtualPage;
+    return hash % NumPhysPages;
+}
+
+int TextCache::Find(ExecImage* image, int virtualPage) {
+    for (int i = hashBuckets[Hash(image, virtualPage)]; i != -1;
+        i = hashNext[i]) {
+        if (images[i] == image && virtualPages[i] == virtualPage) {
+            return i;
+        }
+    }
+    return -1;
+}
+
+int TextCache::Share(ExecImage* image, int virtualPage) {
+    int physicalPage = Find(image, virtualPage);
+    if (physicalPage != -1) {
+        coreMap[physicalPage].refCount++;
+        DEBUG('a', "Sharing code page %d of %s, now used %d times\n",
+            virtualPage, image->name, coreMap[physicalPage].refCount);
+    }
+    return physicalPage;
+}
+
+void TextCache::Add(ExecImage* image, int virtualPage, int physicalPage) {
+    ASSERT(images[physicalPage] == NULL);
+    images[physicalPage] = image;
+    virtualPages[physicalPage] = virtualPage;
+    int bucket = Hash(image, virtualPage);
+    hashNext[physicalPage] = hashBuckets[bucket];
+    hashBuckets[bucket] = physicalPage;
+
+    coreMap[physicalPage].owner = NULL;
+    coreMap[physicalPage].virtualPage = virtualPage;
+    coreMap[physicalPage].refCount = 1;
+}
+
+bool TextCache::Release(int physicalPage) {
+    ASSERT(coreMap[physicalPage].refCount > 0);
+    if (--coreMap[physicalPage].refCount > 0) {
+        return false;
+    }
+    Forget(physicalPage);
+    return true;
+}
+
+void TextCache::Forget(int physicalPage) {
+    int* link = &hashBuckets[Hash(images[physicalPage],
+        virtualPages[physicalPage])];
+    while (*link != physicalPage) {
+        link = &hashNext[*link];
+    }
+    *link = hashNext[physicalPage];
+    hashNext[physicalPage] = -1;
+
+    images[physicalPage] = NULL;
+    virtualPages[physicalPage] = -1;
+
+    coreMap[physicalPage].owner = NULL;
+    coreMap[physicalPage].virtualPage = -1;
+    coreMap[physicalPage].refCount = 0;
+}
+
+#ifdef PAGING
+void TextCache::Attach(AddrSpace* space) {
+    for (int i = 0; i < MaxSharingSpaces; i++) {
+        if (spaces[i] == NULL) {
+            spaces[i] = space;
+            return;
+        }
+    }
+    ASSERT(false);
+}
+
+void TextCache::Detach(AddrSpace* space) {
+    for (int i = 0; i < MaxSharingSpaces; i++) {
+        if (spaces[i] == space) {
+            spaces[i] = NULL;
+            return;
+        }
+    }
+}
+
+void TextCache::Evict(int physicalPage) {
+    int virtualPage = coreMap[physicalPage].virtualPage;
+    DEBUG('v', "Evicting shared virtual page %d from physical page %d\n",
+        virtualPage, physicalPage);
+
+    // shared pages are mapped at the same virtual page everywhere
+    for (int i = 0; i < MaxSharingSpaces; i++) {
+        if (spaces[i] != NULL) {
+            spaces[i]->UnmapSharedPage(virtualPage, physicalPage);
+        }
+    }
+    for (int i = 0; i < TLBSize; i++) {
+        if (machine->tlb[i].valid && machine->tlb[i].physicalPage == physicalPage) {
+            machine->tlb[i].valid = false;
+        }
+    }
+
+    if (images[physicalPage] != NULL) {
+        Forget(physicalPage);
+    } else {
+        coreMap[physicalPage].owner = NULL;
+        coreMap[physicalPage].virtualPage = -1;
+        coreMap[physicalPage].refCount = 0;
+    }
+    freeList->Clear(physicalPage);
+}
+#endif
@@ -0,0 +1,76 @@
+// textcache.h
+//  Data structures to share the code pages of a program between all
+//  the processes running it.
+//
+//  Code pages are never written, so a single copy in physical memory
+//  can back every address space created from the same executable.
+//  The cache remembers, for each physical page holding code, which
+//  program image and which virtual page it came from; the number of
+//  address spaces mapping it is kept in its core map entry.
+//
+//  Pages are keyed by the image, not by the name of the executable:
+//  once the file changes, the image cache hands out a new image, and
+//  processes started from it load their code again instead of mapping
+//  the pages of the old one.  Pages are found through a hash table on
+//  (image, virtual page).
+
+#ifndef USERPROG_TEXTCACHE_H_
+#define USERPROG_TEXTCACHE_H_
+
+#include "processtable.h"
+
+class AddrSpace;
+class ExecImage;
+
+// Address spaces that can be registered for eviction at once: at most
+// one per process
+#define MaxSharingSpaces MAX_NUM_PROCESSES
+
+class TextCache {
+ public:
+    TextCache();
+    ~TextCache();
+
+    // Physical page holding "virtualPage" of "image", or -1
+    int Find(ExecImage* image, int virtualPage);
+
+    // Like Find, but also count one more address space using the page
+    int Share(ExecImage* image, int virtualPage);
+
+    // Record that "physicalPage" now holds "virtualPage" of "image",
+    // used by a single address space
+    void Add(ExecImage* image, int virtualPage, int physicalPage);
+
+    // Drop one user of "physicalPage".  Return true if it was the last
+    // one, in which case the page is forgotten and should be freed.
+    bool Release(int physicalPage);
+
+    #ifdef PAGING
+    // Address spaces that may be mapping shared pages
+    void Attach(AddrSpace* space);
+    void Detach(AddrSpace* space);
+
+    // Take the shared page "physicalPage" away from every address
+    // space mapping it, so it can be reused.  Code pages are reloaded
+    // from the executable on the next fault; copy-on-write pages are
+    // saved to the swap area by each address space.
+    void Evict(int physicalPage);
+    #endif
+
+ private:
+    void Forget(int physicalPage);
+
+    int Hash(ExecImage* image, int virtualPage);
+
+    ExecImage** images;  // Image each physical page was loaded from,
+                         // NULL if it is not a shared code page
+    int* virtualPages;  // Virtual page each physical page holds
+    int* hashNext;  // Next page in the same hash bucket, or -1
+    int* hashBuckets;  // First page of each bucket, or -1
+
+    #ifdef PAGING
+    AddrSpace** spaces;
+    #endif
+};
+
+#endif  // USERPROG_TEXTCACHE_H_
@@ -0,0 +1,182 @@
+// tlbmanager.cc
+//  Routines to refill the TLB on a miss.
+
+#include "system.h"
+#include "tlbmanager.h"
+
+#ifdef USE_TLB
+TlbManager::TlbManager(TlbPolicy tlbPolicy) {
+    policy = tlbPolicy;
+    next = 0;
+    age = new unsigned char[TLBSize];
+    for (int i = 0; i < TLBSize; i++) {
+        age[i] = 0;
+    }
+
+    asids = new BitMap(NumAsids);
+    owners = new AddrSpace*[NumAsids];
+    for (int i = 0; i < NumAsids; i++) {
+        owners[i] = NULL;
+    }
+    generation = 1;
+}
+
+TlbManager::~TlbManager() {
+    delete[] age;
+    delete asids;
+    delete[] owners;
+}
+
+void TlbManager::Refill(TranslationEntry* entry) {
+    int slot = FindVictim();
+
+    if (machine->tlb[slot].valid) {
+        DEBUG('v', "Replacing virtual page %d in TLB slot %d\n",
+            machine->tlb[slot].virtualPage, slot);
+        WriteBack(slot, false);
+    }
+
+    machine->tlb[slot] = *entry;
+    machine->tlb[slot].valid = true;
+    machine->tlb[slot].asid = machine->asid;
+    age[slot] = 0x80;
+}
+
+void TlbManager::Activate(AddrSpace* space) {
+    if (space->asidGeneration != generation) {
+        int asid = asids->Find();
+        if (asid == -1) {
+            NewGeneration();
+            asid = asids->Find();
+        }
+        owners[asid] = space;
+        space->asid = asid;
+        space->asidGeneration = generation;
+        DEBUG('v', "Address space given ASID %d\n", asid);
+    }
+    machine->asid = space->asid;
+}
+
+void TlbManager::Flush(AddrSpace* space) {
+    if (space->asidGeneration != generation)
+        return;
+
+    for (int i = 0; i < TLBSize; i++) {
+        if (machine->tlb[i].valid && machine->tlb[i].asid == space->asid) {
+            WriteBack(i, false);
+            machine->tlb[i].valid = false;
+        }
+    }
+}
+
+void TlbManager::CollectUseBits() {
+    for (int i = 0; i < TLBSize; i++) {
+        if (machine->tlb[i].valid) {
+            WriteBack(i, true);
+        }
+    }
+}
+
+void TlbManager::Release(AddrSpace* space) {
+    if (space->asidGeneration != generation)
+        return;
+
+    for (int i = 0; i < TLBSize; i++) {
+        if (machine->tlb[i].valid && machine->tlb[i].asid == space->asid) {
+            machine->tlb[i].valid = false;
+        }
+    }
+    asids->Clear(space->asid);
+    owners[space->asid] = NULL;
+    space->asidGeneration = 0;
+}
+
+void TlbManager::NewGeneration() {
+    DEBUG('v', "Out of ASIDs, flushing the TLB\n");
+    for (int i = 0; i < TLBSize; i++) {
+        if (machine->tlb[i].valid) {
+            WriteBack(i, false);
+            machine->tlb[i].valid = false;
+        }
+    }
+    for (int i = 0; i < NumAsids; i++) {
+        if (owners[i] != NULL) {
+            asids->Clear(i);
+            owners[i] = NULL;
+        }
+    }
+    generation++;
+}
+
+int TlbManager::FindVictim() {
+    for (int i = 0; i < TLBSize; i++) {
+        if (!machine->tlb[i].valid) {
+            return i;
+        }
+    }
+
+    switch (policy) {
+        case kTlbFifo:
+            return FindVictimFifo();
+        case kTlbLru:
+            return FindVictimLru();
+        case kTlbNru:
+        default:
+            return FindVictimNru();
+    }
+}
+
+int TlbManager::FindVictimFifo() {
+    int slot = next;
+    next = (next + 1) % TLBSize;
+    return slot;
+}
+
+int TlbManager::FindVictimLru() {
+    int victim = 0;
+
+    // shift in the use bit of every slot since the last miss
+    for (int i = 0; i < TLBSize; i++) {
+        age[i] >>= 1;
+        if (machine->tlb[i].use) {
+            age[i] |= 0x80;
+            WriteBack(i, true);
+        }
+        if (age[i] < age[victim]) {
+            victim = i;
+        }
+    }
+    return victim;
+}
+
+int TlbManager::FindVictimNru() {
+    int victim = -1, victimClass = 4;
+
+    // start where the last search ended, not to always pick the same slot
+    for (int n = 0; n < TLBSize && victimClass > 0; n++) {
+        int i = (next + n) % TLBSize;
+        int entryClass = (machine->tlb[i].use ? 2 : 0) +
+            (machine->tlb[i].dirty ? 1 : 0);
+        if (entryClass < victimClass) {
+            victim = i;
+            victimClass = entryClass;
+        }
+    }
+    next = (victim + 1) % TLBSize;
+
+    // every translation has been used: start a new period
+    if (victimClass >= 2) {
+        for (int i = 0; i < TLBSize; i++) {
+            WriteBack(i, true);
+        }
+    }
+    return victim;
+}
+
+void TlbManager::WriteBack(int slot, bool clearUse) {
+    owners[machine->tlb[slot].asid]->SaveTlbEntry(&machine->tlb[slot]);
+    if (clearUse) {
+        machine->tlb[slot].use = false;
+    }
+}
+#endif
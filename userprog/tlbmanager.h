@@ -0,0 +1,87 @@
+// tlbmanager.h
+//  Data structures to manage the contents of the software-loaded TLB.
+//
+//  On a TLB miss, the kernel loads the missing translation into a free
+//  TLB slot, or replaces one of the translations there.  The use and
+//  dirty bits of the replaced translation are copied back into the page
+//  table first, so page replacement knows which pages have been used.
+//
+//  The replacement policy is chosen when Nachos starts:
+//
+//  fifo -- replace translations in the order they were loaded
+//  lru  -- replace the least recently used translation, approximated
+//          by aging the use bits each time the TLB misses
+//  nru  -- replace a translation not used since use bits were last
+//          cleared, preferring clean ones
+//
+//  Translations are tagged with an address space identifier (ASID), so
+//  those of several processes can stay in the TLB across context
+//  switches.  ASIDs are handed out in generations: when they run out,
+//  the whole TLB is flushed and every address space gets a new one the
+//  next time it runs.
+
+#ifndef USERPROG_TLBMANAGER_H_
+#define USERPROG_TLBMANAGER_H_
+
+#include "translate.h"
+#include "bitmap.h"
+
+#define NumAsids 64  // Address space identifiers the TLB can tell apart
+
+class AddrSpace;
+
+enum TlbPolicy {
+    kTlbFifo,
+    kTlbLru,
+    kTlbNru
+};
+
+class TlbManager {
+ public:
+    explicit TlbManager(TlbPolicy policy);
+    ~TlbManager();
+
+    // Load "entry", from the page table of the running address space,
+    // into the TLB
+    void Refill(TranslationEntry* entry);
+
+    // Make the TLB match the translations of "space", which is about
+    // to run, giving it an ASID first if needed
+    void Activate(AddrSpace* space);
+
+    // Save the use and dirty bits of the translations of "space" in the
+    // TLB, and remove them from it
+    void Flush(AddrSpace* space);
+
+    // Copy the use bits of every translation in the TLB back to the
+    // page tables, and clear them, so page replacement sees the pages
+    // referenced since the last time
+    void CollectUseBits();
+
+    // "space" is going away: forget its translations, and free its ASID
+    void Release(AddrSpace* space);
+
+ private:
+    int FindVictim();  // Slot to load the new translation into
+    int FindVictimFifo();
+    int FindVictimLru();
+    int FindVictimNru();
+
+    // Copy the use and dirty bits of a TLB slot into the page table,
+    // optionally clearing its use bit afterwards
+    void WriteBack(int slot, bool clearUse);
+
+    // Start a new ASID generation, flushing the whole TLB
+    void NewGeneration();
+
+    TlbPolicy policy;
+    int next;  // Next slot to replace, for FIFO
+    unsigned char* age;  // Use bits sampled at each miss, for LRU;
+                         // the most recent one is the highest bit
+
+    BitMap* asids;  // ASIDs given out in this generation
+    AddrSpace** owners;  // Address space each ASID was given to
+    int generation;
+};
+
+#endif  // USERPROG_TLBMANAGER_H_
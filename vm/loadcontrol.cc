@@ -0,0 +1,125 @@
+// loadcontrol.cc
+//  Routines to suspend and resume processes according to their
+//  working sets.
+
+#include "system.h"
+#include "loadcontrol.h"
+
+#ifdef PAGING
+LoadControl::LoadControl(bool suspendProcesses) {
+    enabled = suspendProcesses;
+    spaces = new AddrSpace*[MaxLoadControlSpaces];
+    waitingThreads = new int[MaxLoadControlSpaces];
+    suspendedThreads = new int[MaxLoadControlSpaces];
+    resume = new Semaphore*[MaxLoadControlSpaces];
+    for (int i = 0; i < MaxLoadControlSpaces; i++) {
+        spaces[i] = NULL;
+        resume[i] = NULL;
+    }
+}
+
+LoadControl::~LoadControl() {
+    for (int i = 0; i < MaxLoadControlSpaces; i++) {
+        delete resume[i];
+    }
+    delete[] spaces;
+    delete[] waitingThreads;
+    delete[] suspendedThreads;
+    delete[] resume;
+}
+
+void LoadControl::Attach(AddrSpace* space) {
+    int i = Find(NULL);
+    ASSERT(i != -1);
+    spaces[i] = space;
+    waitingThreads[i] = 0;
+    suspendedThreads[i] = 0;
+    resume[i] = new Semaphore("resume", 0);
+}
+
+void LoadControl::Detach(AddrSpace* space) {
+    int i = Find(space);
+    ASSERT(suspendedThreads[i] == 0);
+    spaces[i] = NULL;
+    delete resume[i];
+    resume[i] = NULL;
+
+    // its working set no longer counts
+    Update();
+}
+
+void LoadControl::SetWaiting(AddrSpace* space, bool waiting) {
+    int i = Find(space);
+    if (waiting) {
+        waitingThreads[i]++;
+        Update();
+    } else {
+        waitingThreads[i]--;
+    }
+}
+
+void LoadControl::Admit(AddrSpace* space) {
+    if (!enabled)
+        return;
+
+    int i = Find(space);
+    for (;;) {
+        int running;
+        int total = RunningWorkingSets(&running);
+        if (total <= NumPhysPages || running <= 1)
+            return;
+
+        DEBUG('v', "Suspending a process, working sets add up to %d pages\n",
+            total);
+        stats->numSuspensions++;
+        suspendedThreads[i]++;
+        resume[i]->P();
+    }
+}
+
+void LoadControl::Update() {
+    int running;
+    int total = RunningWorkingSets(&running);
+    if (total > stats->maxTotalWorkingSet)
+        stats->maxTotalWorkingSet = total;
+    if (!enabled)
+        return;
+
+    for (int i = 0; i < MaxLoadControlSpaces; i++) {
+        if (spaces[i] == NULL || suspendedThreads[i] == 0)
+            continue;
+        int size = spaces[i]->WorkingSetSize();
+        if (running > 0 && total + size > NumPhysPages)
+            continue;
+
+        DEBUG('v', "Resuming a process, working sets add up to %d pages\n",
+            total + size);
+        total += size;
+        running++;
+        for (; suspendedThreads[i] > 0; suspendedThreads[i]--) {
+            resume[i]->V();
+        }
+    }
+}
+
+int LoadControl::Find(AddrSpace* space) {
+    for (int i = 0; i < MaxLoadControlSpaces; i++) {
+        if (spaces[i] == space)
+            return i;
+    }
+    return -1;
+}
+
+int LoadControl::RunningWorkingSets(int* running) {
+    int total = 0;
+    *running = 0;
+    for (int i = 0; i < MaxLoadControlSpaces; i++) {
+        if (spaces[i] != NULL && waitingThreads[i] + suspendedThreads[i] <
+            spaces[i]->NumThreads()) {
+            total += spaces[i]->WorkingSetSize();
+            (*running)++;
+        }
+    }
+    return total;
+}
+#endif
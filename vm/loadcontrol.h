@@ -0,0 +1,64 @@
+// loadcontrol.h
+//  Data structures to keep track of the working sets of the processes,
+//  and to suspend some of them when they do not all fit in memory.
+//
+//  When the working sets of the running processes add up to more than
+//  the physical memory, they keep evicting each other's pages.  With
+//  load control enabled, a process that page faults while that is the
+//  case is suspended, unless it is the only one left running.  Its
+//  pages are then evicted as the others need room, and it is resumed
+//  once its working set fits again.
+//
+//  A process counts as running while some of its threads are neither
+//  suspended, waiting in Join nor exiting; a parent must not keep a
+//  suspended child from running while it waits for it.  Exiting
+//  threads are let go at once, since the address space is only
+//  deleted when the next thread gets to run.
+
+#ifndef VM_LOADCONTROL_H_
+#define VM_LOADCONTROL_H_
+
+#include "processtable.h"
+#include "synch.h"
+
+class AddrSpace;
+
+// Address spaces that can be tracked at once: at most one per process
+#define MaxLoadControlSpaces MAX_NUM_PROCESSES
+
+class LoadControl {
+ public:
+    // Keep track of working sets; only suspend processes if "enabled"
+    explicit LoadControl(bool enabled);
+    ~LoadControl();
+
+    // Start and stop keeping track of "space"
+    void Attach(AddrSpace* space);
+    void Detach(AddrSpace* space);
+
+    // A thread of "space" starts or stops waiting for another process,
+    // or is about to exit
+    void SetWaiting(AddrSpace* space, bool waiting);
+
+    // Suspend the calling thread, running in "space", for as long as
+    // the working sets do not fit in memory
+    void Admit(AddrSpace* space);
+
+    // The working sets changed: resume the processes that fit again
+    void Update();
+
+ private:
+    int Find(AddrSpace* space);
+
+    // Total of the working sets of the running processes, and how many
+    // of them there are
+    int RunningWorkingSets(int* running);
+
+    bool enabled;
+    AddrSpace** spaces;
+    int* waitingThreads;  // Threads of each space waiting or exiting
+    int* suspendedThreads;  // Threads of each space suspended
+    Semaphore** resume;  // Where suspended threads wait
+};
+
+#endif  // VM_LOADCONTROL_H_
@@ -0,0 +1,49 @@
+// pageout.cc
+//  Routines of the pageout daemon.
+
+#include "system.h"
+#include "pageout.h"
+
+#ifdef PAGING
+PageoutDaemon::PageoutDaemon() {
+    wakeup = new Semaphore("pageout", 0);
+    awake = false;
+
+    Thread* thread = new Thread("pageout daemon", false, true);
+    thread->Fork(Run, this);
+}
+
+PageoutDaemon::~PageoutDaemon() {
+    delete wakeup;
+}
+
+void PageoutDaemon::Check() {
+    if (!awake && freeList->NumClear() < PageoutLowWater) {
+        awake = true;
+        wakeup->V();
+    }
+}
+
+void PageoutDaemon::Run(void* daemon) {
+    for (;;) {
+        static_cast<PageoutDaemon*>(daemon)->Evict();
+    }
+}
+
+void PageoutDaemon::Evict() {
+    wakeup->P();
+    awake = false;
+    DEBUG('v', "Pageout daemon woken up, %d free physical pages\n",
+        freeList->NumClear());
+
+    while (freeList->NumClear() < PageoutHighWater) {
+        pagingLock->Acquire();
+        // a page fault may have freed pages while we waited for the lock
+        if (freeList->NumClear() < PageoutHighWater) {
+            AddrSpace::MakeRoom();
+            stats->numPageoutEvictions++;
+        }
+        pagingLock->Release();
+    }
+}
+#endif
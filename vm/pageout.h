@@ -0,0 +1,39 @@
+// pageout.h
+//  Data structures for the pageout daemon, a kernel thread that evicts
+//  pages in the background.
+//
+//  Page faults take free physical pages when there are any, and only
+//  evict a page themselves when there are none.  Whenever a fault
+//  leaves fewer than PageoutLowWater pages free, it wakes the daemon,
+//  which evicts pages chosen by the usual page replacement until
+//  PageoutHighWater pages are free.  The daemon takes pagingLock for
+//  each page, so faults can be handled in between.
+
+#ifndef VM_PAGEOUT_H_
+#define VM_PAGEOUT_H_
+
+#include "synch.h"
+
+// Free physical pages below which the daemon is woken up, and which it
+// tries to reach
+#define PageoutLowWater (NumPhysPages / 8)
+#define PageoutHighWater (NumPhysPages / 4)
+
+class PageoutDaemon {
+ public:
+    // Create the daemon thread, asleep
+    PageoutDaemon();
+    ~PageoutDaemon();
+
+    // Wake the daemon up, if there are too few free physical pages
+    void Check();
+
+ private:
+    static void Run(void* daemon);  // Body of the daemon thread
+    void Evict();  // Free pages until there are enough
+
+    Semaphore* wakeup;
+    bool awake;  // Already woken up, and not done yet
+};
+
+#endif  // VM_PAGEOUT_H_
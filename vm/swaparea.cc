@@ -0,0 +1,58 @@
+// swaparea.cc
+//  Routines to manage the swap area.
+
+#include "system.h"
+#include "swaparea.h"
+
+#ifdef PAGING
+
+SwapArea::SwapArea(const char* name) {
+    ASSERT(PageSize % SectorSize == 0);
+
+    fileName = new char[strlen(name) + 1];
+    strcpy(fileName, name);
+    disk = new SynchDisk(fileName);
+    slots = new BitMap(NumSwapSlots, true);  // evictions fill slots in order
+}
+
+SwapArea::~SwapArea() {
+    delete slots;
+    delete disk;
+    Unlink(fileName);
+    delete[] fileName;
+}
+
+int SwapArea::Allocate() {
+    int slot = slots->Find();
+    DEBUG('v', "Allocated swap slot %d\n", slot);
+    return slot;
+}
+
+void SwapArea::Free(int slot) {
+    ASSERT(slots->Test(slot));
+    slots->Clear(slot);
+}
+
+void SwapArea::ReadPage(int slot, char* into) {
+    ASSERT(slots->Test(slot));
+    char** data = SectorBuffers(into);
+    disk->ReadSectors(slot * SectorsPerPage, SectorsPerPage, data);
+    delete[] data;
+}
+
+void SwapArea::WritePage(int slot, const char* from) {
+    ASSERT(slots->Test(slot));
+    char** data = SectorBuffers(const_cast<char*>(from));
+    disk->WriteSectors(slot * SectorsPerPage, SectorsPerPage, data);
+    delete[] data;
+}
+
+char** SwapArea::SectorBuffers(char* page) {
+    char** data = new char*[SectorsPerPage];
+    for (int i = 0; i < SectorsPerPage; i++) {
+        data[i] = &page[i * SectorSize];
+    }
+    return data;
+}
+
+#endif
@@ -0,0 +1,50 @@
+// swaparea.h
+//  Data structures to manage the swap area, where pages evicted from
+//  physical memory are kept until they are needed again.
+//
+//  The swap area is a disk of its own, used without a file system:
+//  each page is kept in a slot of consecutive sectors (just one, with
+//  the default page size).  Slots are handed out to address spaces
+//  from a bitmap, one per page they evict, and are read and written
+//  directly, bypassing any file system.
+
+#ifndef VM_SWAPAREA_H_
+#define VM_SWAPAREA_H_
+
+#include "bitmap.h"
+#include "synchdisk.h"
+
+// Sectors holding a page, and pages the swap area can hold
+#define SectorsPerPage (PageSize / SectorSize)
+#define NumSwapSlots (NumSectors / SectorsPerPage)
+
+class SwapArea {
+ public:
+    // Create an empty swap area, on the disk kept in the UNIX file "name"
+    explicit SwapArea(const char* name);
+
+    // Remove the swap area, and the file holding it
+    ~SwapArea();
+
+    // A free slot to keep a page in, or -1 if the swap area is full
+    int Allocate();
+
+    // Slot "slot" is no longer needed
+    void Free(int slot);
+
+    // Read the page kept in "slot" into "into", and write "from" into
+    // "slot", each in a single disk request.  Both wait for the disk.
+    void ReadPage(int slot, char* into);
+    void WritePage(int slot, const char* from);
+
+ private:
+    // The buffer of each sector of "page", as disk requests take them;
+    // the caller deletes the array
+    char** SectorBuffers(char* page);
+
+    char* fileName;
+    SynchDisk* disk;
+    BitMap* slots;  // Slots in use
+};
+
+#endif  // VM_SWAPAREA_H_